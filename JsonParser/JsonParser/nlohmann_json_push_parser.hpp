@@ -0,0 +1,96 @@
+//
+//  nlohmann_json_push_parser.hpp
+//  JsonParser
+//
+//  Created by 朱继超 on 10/16/26.
+//
+
+#ifndef nlohmann_json_push_parser_hpp
+#define nlohmann_json_push_parser_hpp
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "nlohmann_json_wrapper.hpp"
+#include "rapid_json_document_framer.hpp"
+
+
+namespace nlohmann {
+
+// 推送式解析器: 按任意大小的块送入字节, 每结束一个顶层文档即解码为Derived并交给回调
+// 适用于被拆分到多个网络包中的消息, 以及首尾相接、没有分隔符的多个文档
+// 由JsonDocumentFramer找出文档边界后再完整解析该文档, 因此每个字节先分帧、再解析;
+// 完整位于一块内的文档直接从该块解析, 跨块的文档先复制到分帧器的缓冲区
+//
+// 用法:
+//     JsonPushParser<User> parser;
+//     parser.feed(packet, size, [](User& user) { ... }, [](const JsonPushParser<User>& p) { ... });
+//     parser.finish(...);    // 输入结束时处理最后一个未结束的文档
+template<typename Derived>
+class JsonPushParser {
+public:
+    JsonPushParser() {}
+
+    JsonPushParser(const JsonPushParser&) = delete;
+    JsonPushParser& operator=(const JsonPushParser&) = delete;
+
+    // 送入一段字节, 对其中结束的每个顶层文档调用onDocument(Derived&)或onBadDocument(const JsonPushParser&)
+    // 无法解析或根节点不是对象的文档被跳过, 不影响后续文档; 返回成功解码的文档数
+    template<typename OnDocument, typename OnBadDocument>
+    size_t feed(const char* data, size_t length, OnDocument onDocument, OnBadDocument onBadDocument) {
+        size_t count = 0;
+        framer.feed(data, length, [&](const char* document, size_t size) {
+            count += deliver(document, size, onDocument, onBadDocument);
+        });
+        return count;
+    }
+
+    // 输入结束: 解码尚未结束的最后一个文档(结尾没有分隔符的标量, 或被截断的文档)并回到初始状态
+    // 返回成功解码的文档数
+    template<typename OnDocument, typename OnBadDocument>
+    size_t finish(OnDocument onDocument, OnBadDocument onBadDocument) {
+        size_t count = 0;
+        framer.finish([&](const char* document, size_t size) {
+            count += deliver(document, size, onDocument, onBadDocument);
+        });
+        return count;
+    }
+
+    // 丢弃未结束的文档, 从下一个字节开始作为新的输入; 已送入的字节数继续累计
+    void reset() { framer.reset(); }
+
+    Derived& getRecord() { return record; }
+
+    // 最近一个文档首字节在全部输入中的偏移
+    size_t getDocumentOffset() const { return framer.getDocumentOffset(); }
+
+    // 尚未结束的文档已缓存的字节数
+    size_t getPendingSize() const { return framer.getPendingSize(); }
+
+private:
+    template<typename OnDocument, typename OnBadDocument>
+    size_t deliver(const char* data, size_t length, OnDocument& onDocument, OnBadDocument& onBadDocument) {
+        if (decode(data, length)) {
+            onDocument(record);
+            return 1;
+        }
+        onBadDocument(*this);
+        return 0;
+    }
+
+    // 每个文档都从默认构造的字段值开始解码, 字段已分配的容量被保留; 语法错误不抛出异常
+    bool decode(const char* data, size_t length) {
+        record = blank;
+        json obj = json::parse(data, data + length, nullptr, false);
+        return !obj.is_discarded() && record.fromJsonNode(obj);
+    }
+
+    rapidjson::detail::JsonDocumentFramer framer;
+
+    Derived record;
+    const Derived blank;
+};
+
+}
+
+#endif /* nlohmann_json_push_parser_hpp */
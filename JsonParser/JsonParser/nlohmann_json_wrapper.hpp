@@ -9,12 +9,30 @@
 #define nlohmann_json_wrapper_hpp
 
 #include <stdio.h>
+#include <string.h>
+#include <assert.h>
 #include <iostream>
 #include <string>
 #include <vector>
-#include <functional>
+#include <algorithm>
 #include <unordered_map>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <exception>
+#include <stdexcept>
+#include <typeinfo>
 #include <type_traits>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 #include "json.hpp"
 
 
@@ -57,29 +75,50 @@ public:
         return serializer;
     }
 
+    // 通常在构造函数中调用, 可在多个线程中同时调用; 已注册过的名称直接返回
+    // 新的值在锁内加入当前映射表的副本后发布, 读取方无锁地读到完整的映射表;
+    // 旧的映射表保留到程序结束, nameOf返回的指针始终有效
     void registerValue(const std::string& name, EnumType value) {
-        stringToEnum[name] = value;
-        enumToString[static_cast<UnderlyingType>(value)] = name;
+        if (isRegistered(*current.load(std::memory_order_acquire), name, value)) return;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        const Maps& maps = *current.load(std::memory_order_relaxed);
+        if (isRegistered(maps, name, value)) return;
+
+        std::unique_ptr<Maps> next(new Maps(maps));
+        next->stringToEnum[name] = value;
+        next->enumToString[static_cast<UnderlyingType>(value)] = name;
+        snapshots.push_back(std::move(next));
+        current.store(snapshots.back().get(), std::memory_order_release);
+    }
+
+    // 按枚举值查找名称, 未注册时返回nullptr
+    static const std::string* nameOf(EnumType value) {
+        const Maps& maps = *instance().current.load(std::memory_order_acquire);
+        auto it = maps.enumToString.find(static_cast<UnderlyingType>(value));
+        return it != maps.enumToString.end() ? &it->second : nullptr;
+    }
+
+    // 按名称查找枚举值, 未注册时不修改value
+    static bool valueOf(const std::string& name, EnumType& value) {
+        const Maps& maps = *instance().current.load(std::memory_order_acquire);
+        auto it = maps.stringToEnum.find(name);
+        if (it == maps.stringToEnum.end()) return false;
+        value = it->second;
+        return true;
     }
 
     static void serialize(json& obj, const std::string& key, const EnumType& value) {
-        auto& inst = instance();
-        auto it = inst.enumToString.find(static_cast<UnderlyingType>(value));
-        if (it != inst.enumToString.end()) {
-            obj[key] = it->second;
+        if (const std::string* name = nameOf(value)) {
+            obj[key] = *name;
         }
     }
 
     static void deserialize(const json& obj, const std::string& key, EnumType& value) {
-        auto& inst = instance();
         if (obj.contains(key)) {
             const auto& jsonValue = obj[key];
             if (jsonValue.is_string()) {
-                std::string strValue = jsonValue.get<std::string>();
-                auto it = inst.stringToEnum.find(strValue);
-                if (it != inst.stringToEnum.end()) {
-                    value = it->second;
-                }
+                valueOf(jsonValue.get_ref<const std::string&>(), value);
             } else if (jsonValue.is_number()) {
                 value = static_cast<EnumType>(jsonValue.get<int>());
             }
@@ -87,247 +126,863 @@ public:
     }
 
 private:
-    MapType stringToEnum;
-    ReverseMapType enumToString;
+    struct Maps {
+        MapType stringToEnum;
+        ReverseMapType enumToString;
+    };
+
+    EnumSerializer() : current(nullptr) {
+        snapshots.emplace_back(new Maps());
+        current.store(snapshots.back().get(), std::memory_order_release);
+    }
+
+    static bool isRegistered(const Maps& maps, const std::string& name, EnumType value) {
+        auto it = maps.stringToEnum.find(name);
+        return it != maps.stringToEnum.end() && it->second == value;
+    }
+
+    std::mutex mutex;                                   // 串行化registerValue
+    std::atomic<const Maps*> current;                   // 最新发布的映射表
+    std::vector<std::unique_ptr<Maps>> snapshots;       // 发布过的所有映射表
 };
 
 
-// 基础序列化类
-template<typename Derived>
-class JSONSerializable {
-protected:
-    // 存储属性描述器
-    std::vector<std::function<void(json&)>> serializers;
-    std::vector<std::function<void(const json&)>> deserializers;
-
-    // 注册属性 - 基本类型
-    template<typename T, typename Enable = void>
-    class PropertySerializer {
-    public:
-        static void serialize(json& obj, const std::string& key, const T& value);
-        static void deserialize(const json& obj, const std::string& key, T& value);
-    };
+// 属性类型
+enum PropertyKind {
+    kStringProperty,
+    kIntProperty,
+    kUintProperty,
+    kUint64Property,
+    kDoubleProperty,
+    kBoolProperty,
+    kEnumProperty,
+    kObjectProperty,
+    kObjectArrayProperty
+};
+
+class ClassSchema;
+
+// 枚举、嵌套对象等需要类型信息的属性操作表, 每种类型只有一份
+struct PropertyTypeInfo {
+    // 将字段写入out, 返回false时不输出该属性
+    bool (*serialize)(const void* field, json& out);
+    void (*deserialize)(const json& in, void* field);
+
+    // 以下供SAX解码使用, 枚举为nullptr
+    const ClassSchema& (*schema)();         // 嵌套对象或数组元素的属性表
+    void (*clearElements)(void* field);     // 清空嵌套数组
+    void* (*appendElement)(void* field);    // 向嵌套数组追加一个默认构造的元素
+};
+
+// 属性描述器, 同一类型的所有实例共享
+struct PropertyDescriptor {
+    std::string key;
+    size_t offset;                      // 成员相对对象起始地址的偏移
+    PropertyKind kind;
+    const PropertyTypeInfo* typeInfo;   // 基本类型为nullptr
+
+    template<typename T>
+    const T& field(const void* object) const {
+        return *reinterpret_cast<const T*>(static_cast<const char*>(object) + offset);
+    }
+
+    template<typename T>
+    T& field(void* object) const {
+        return *reinterpret_cast<T*>(static_cast<char*>(object) + offset);
+    }
+};
+
+// 键到属性下标的最小完美哈希(hash-and-displace), 属性表构建完成后生成一次
+// 查找只需两次哈希和一次键比较, 与属性个数无关
+class PropertyIndex {
+public:
+    void build(const std::vector<PropertyDescriptor>& properties) {
+        size_t size = 1;
+        while (size < properties.size()) size <<= 1;
+        // 种子搜索失败的概率极低, 失败时加倍槽位重试
+        while (!tryBuild(properties, size)) size <<= 1;
+    }
+
+    // 返回可能匹配的属性下标, 没有候选时返回-1; 调用方需再比较键
+    int find(const std::string& key) const {
+        if (slots.empty()) return -1;
+        int32_t d = displacements[hash(0, key) & mask];
+        uint32_t slot = d < 0 ? static_cast<uint32_t>(-d - 1) : hash(static_cast<uint32_t>(d), key) & mask;
+        return slots[slot];
+    }
 
-    // 特化 std::string
-    template<>
-    class PropertySerializer<std::string> {
-    public:
-        static void serialize(json& obj, const std::string& key, const std::string& value) {
-            obj[key] = value;
+private:
+    static const uint32_t kMaxSeed = 1u << 16;
+
+    bool tryBuild(const std::vector<PropertyDescriptor>& properties, size_t size) {
+        mask = static_cast<uint32_t>(size - 1);
+        displacements.assign(size, 0);
+        slots.assign(size, -1);
+
+        // 第一级: 按种子0的哈希分桶, 重复注册的键只保留第一次
+        std::vector<std::vector<int>> buckets(size);
+        for (size_t i = 0; i < properties.size(); i++) {
+            const PropertyDescriptor& p = properties[i];
+            bool duplicate = false;
+            for (size_t j = 0; j < i && !duplicate; j++) {
+                duplicate = properties[j].key == p.key;
+            }
+            if (!duplicate) buckets[hash(0, p.key) & mask].push_back(static_cast<int>(i));
         }
 
-        static void deserialize(const json& obj, const std::string& key, std::string& value) {
-            if (obj.contains(key) && obj[key].is_string()) {
-                value = obj[key].get<std::string>();
+        // 第二级: 从大桶开始为每个桶寻找使其所有键落入空槽的种子
+        std::vector<size_t> order(size);
+        for (size_t b = 0; b < size; b++) order[b] = b;
+        std::stable_sort(order.begin(), order.end(), [&buckets](size_t a, size_t b) {
+            return buckets[a].size() > buckets[b].size();
+        });
+
+        std::vector<uint32_t> taken;
+        size_t next = 0;
+        for (size_t b : order) {
+            const std::vector<int>& bucket = buckets[b];
+            if (bucket.empty()) break;
+
+            if (bucket.size() == 1) {
+                // 单键桶直接占用一个空槽, 以负数记录槽位
+                while (slots[next] != -1) next++;
+                slots[next] = bucket[0];
+                displacements[b] = -static_cast<int32_t>(next) - 1;
+                continue;
+            }
+
+            uint32_t seed = 1;
+            for (; seed <= kMaxSeed; seed++) {
+                taken.clear();
+                for (int index : bucket) {
+                    const PropertyDescriptor& p = properties[index];
+                    uint32_t slot = hash(seed, p.key) & mask;
+                    if (slots[slot] != -1 || std::find(taken.begin(), taken.end(), slot) != taken.end()) break;
+                    taken.push_back(slot);
+                }
+                if (taken.size() == bucket.size()) break;
             }
+            if (seed > kMaxSeed) return false;
+
+            for (size_t k = 0; k < taken.size(); k++) slots[taken[k]] = bucket[k];
+            displacements[b] = static_cast<int32_t>(seed);
         }
-    };
+        return true;
+    }
 
-    // 特化 int
-    template<>
-    class PropertySerializer<int> {
-    public:
-        static void serialize(json& obj, const std::string& key, const int& value) {
-            obj[key] = value;
+    // 以种子扰动初值的FNV-1a; FNV结果的低位只取决于各字节的低位, 取槽位前再混合高位
+    static uint32_t hash(uint32_t seed, const std::string& key) {
+        uint32_t h = 2166136261u ^ (seed * 0x9E3779B9u);
+        for (char c : key) {
+            h ^= static_cast<unsigned char>(c);
+            h *= 16777619u;
         }
+        h ^= h >> 16;
+        h *= 0x85EBCA6Bu;
+        h ^= h >> 13;
+        return h;
+    }
+
+    std::vector<int32_t> displacements;     // 每个桶的种子, 负数表示单键桶的槽位
+    std::vector<int> slots;                 // 槽位到属性下标
+    uint32_t mask = 0;
+};
+
+// 类型属性表: 每个Derived类型只构建一次, toJson/fromJson遍历该表
+class ClassSchema {
+public:
+    ClassSchema() = default;
+    ClassSchema(const ClassSchema&) = delete;
+    ClassSchema& operator=(const ClassSchema&) = delete;
+
+    void addProperty(const char* key, size_t offset, PropertyKind kind, const PropertyTypeInfo* typeInfo) {
+        properties.push_back(PropertyDescriptor{ key, offset, kind, typeInfo });
+    }
 
-        static void deserialize(const json& obj, const std::string& key, int& value) {
-            if (obj.contains(key) && obj[key].is_number_integer()) {
-                value = obj[key].get<int>();
+    const std::vector<PropertyDescriptor>& getProperties() const { return properties; }
+
+    // 按键查找属性, 未注册时返回nullptr
+    const PropertyDescriptor* findProperty(const std::string& key) const {
+        if (properties.size() <= kLinearScanLimit) {
+            for (const auto& p : properties) {
+                if (p.key == key) {
+                    return &p;
+                }
             }
+            return nullptr;
         }
-    };
 
-    // 特化 double
-    template<>
-    class PropertySerializer<double> {
-    public:
-        static void serialize(json& obj, const std::string& key, const double& value) {
-            obj[key] = value;
-        }
+        int index = keyIndex.find(key);
+        if (index < 0) return nullptr;
+
+        const PropertyDescriptor& p = properties[index];
+        return p.key == key ? &p : nullptr;
+    }
 
-        static void deserialize(const json& obj, const std::string& key, double& value) {
-            if (obj.contains(key) && obj[key].is_number()) {
-                value = obj[key].get<double>();
+    // 所有属性注册完成后生成键索引; 属性较少时线性比较更快, 不生成索引
+    void buildIndex() {
+        if (properties.size() > kLinearScanLimit) keyIndex.build(properties);
+    }
+
+    // 按属性表将object写入obj
+    void serialize(const void* object, json& obj) const {
+        for (const auto& p : properties) {
+            switch (p.kind) {
+            case kStringProperty: obj[p.key] = p.field<std::string>(object); break;
+            case kIntProperty:    obj[p.key] = p.field<int>(object); break;
+            case kUintProperty:   obj[p.key] = p.field<unsigned int>(object); break;
+            case kUint64Property: obj[p.key] = p.field<uint64_t>(object); break;
+            case kDoubleProperty: obj[p.key] = p.field<double>(object); break;
+            case kBoolProperty:   obj[p.key] = p.field<bool>(object); break;
+            default: {
+                json v;
+                if (p.typeInfo->serialize(static_cast<const char*>(object) + p.offset, v)) {
+                    obj[p.key] = std::move(v);
+                }
+                break;
+            }
             }
         }
-    };
+    }
+
+    // 遍历obj的成员一次并按键分发到属性, 缺失或类型不符的键保持字段不变
+    void deserialize(const json& obj, void* object) const {
+        for (auto it = obj.begin(); it != obj.end(); ++it) {
+            const PropertyDescriptor* p = findProperty(it.key());
+            if (!p) continue;
 
-    // 特化 bool
-    template<>
-    class PropertySerializer<bool> {
-    public:
-        static void serialize(json& obj, const std::string& key, const bool& value) {
-            obj[key] = value;
+            deserializeProperty(*p, it.value(), object);
         }
+    }
 
-        static void deserialize(const json& obj, const std::string& key, bool& value) {
-            if (obj.contains(key) && obj[key].is_boolean()) {
-                value = obj[key].get<bool>();
-            }
+    // 将单个值写入属性, 类型不符时保持字段不变
+    static void deserializeProperty(const PropertyDescriptor& p, const json& v, void* object) {
+        switch (p.kind) {
+        case kStringProperty:
+            if (v.is_string()) p.field<std::string>(object) = v.get_ref<const std::string&>();
+            break;
+        case kIntProperty:
+            if (v.is_number_integer()) p.field<int>(object) = v.get<int>();
+            break;
+        case kUintProperty:
+            if (v.is_number_unsigned()) p.field<unsigned int>(object) = v.get<unsigned int>();
+            break;
+        case kUint64Property:
+            if (v.is_number_unsigned()) p.field<uint64_t>(object) = v.get<uint64_t>();
+            break;
+        case kDoubleProperty:
+            if (v.is_number()) p.field<double>(object) = v.get<double>();
+            break;
+        case kBoolProperty:
+            if (v.is_boolean()) p.field<bool>(object) = v.get<bool>();
+            break;
+        default:
+            p.typeInfo->deserialize(v, static_cast<char*>(object) + p.offset);
+            break;
         }
-    };
+    }
+
+private:
+    static const size_t kLinearScanLimit = 8;
+
+    std::vector<PropertyDescriptor> properties;
+    PropertyIndex keyIndex;
+};
+
+// 属性类型萃取, 不支持的类型没有定义
+template<typename T, typename Enable = void>
+struct PropertyTraits;
+
+template<PropertyKind Kind>
+struct BasicPropertyTraits {
+    static const PropertyKind kind = Kind;
+    static const PropertyTypeInfo* typeInfo() { return nullptr; }
+};
+
+// 特化 std::string
+template<> struct PropertyTraits<std::string> : BasicPropertyTraits<kStringProperty> {};
+// 特化 int
+template<> struct PropertyTraits<int> : BasicPropertyTraits<kIntProperty> {};
+//特化unsigned int
+template<> struct PropertyTraits<unsigned int> : BasicPropertyTraits<kUintProperty> {};
+//特化uint64_t
+template<> struct PropertyTraits<uint64_t> : BasicPropertyTraits<kUint64Property> {};
+// 特化 double
+template<> struct PropertyTraits<double> : BasicPropertyTraits<kDoubleProperty> {};
+// 特化 bool
+template<> struct PropertyTraits<bool> : BasicPropertyTraits<kBoolProperty> {};
 
-    //特化unsigned int
-    template<>
-    class PropertySerializer<unsigned int> {
-    public:
-        static void serialize(json& obj, const std::string& key, const unsigned int& value) {
-            obj[key] = value;
+// 添加枚举特化
+template<typename T>
+struct PropertyTraits<T, typename std::enable_if<std::is_enum<T>::value>::type> {
+    static const PropertyKind kind = kEnumProperty;
+
+    static bool serialize(const void* field, json& out) {
+        const std::string* name = EnumSerializer<T>::nameOf(*static_cast<const T*>(field));
+        if (!name) return false;
+        out = *name;
+        return true;
+    }
+
+    static void deserialize(const json& in, void* field) {
+        T& value = *static_cast<T*>(field);
+        if (in.is_string()) {
+            EnumSerializer<T>::valueOf(in.get_ref<const std::string&>(), value);
+        } else if (in.is_number()) {
+            value = static_cast<T>(in.get<int>());
         }
+    }
+
+    static const PropertyTypeInfo* typeInfo() {
+        static const PropertyTypeInfo info = { &serialize, &deserialize, nullptr, nullptr, nullptr };
+        return &info;
+    }
+};
 
-        static void deserialize(const json& obj, const std::string& key, unsigned int& value) {
-            if (obj.contains(key) && obj[key].is_number_unsigned()) {
-                value = obj[key].get<unsigned int>();
+// 嵌套对象
+template<typename T>
+struct NestedObjectTraits {
+    // 直接写入父节点
+    static bool serialize(const void* field, json& out) {
+        out = json::object();
+        T::schema().serialize(static_cast<const T*>(field), out);
+        return true;
+    }
+
+    // 原地解码, 缺失的键保持字段不变
+    static void deserialize(const json& in, void* field) {
+        static_cast<T*>(field)->fromJsonNode(in);
+    }
+
+    static const ClassSchema& schema() {
+        return T::schema();
+    }
+
+    static const PropertyTypeInfo* typeInfo() {
+        static const PropertyTypeInfo info = { &serialize, &deserialize, &schema, nullptr, nullptr };
+        return &info;
+    }
+};
+
+// 嵌套对象数组
+template<typename T>
+struct NestedArrayTraits {
+    static bool serialize(const void* field, json& out) {
+        const std::vector<T>& value = *static_cast<const std::vector<T>*>(field);
+        const ClassSchema& schema = T::schema();
+        out = json::array();
+        out.get_ref<json::array_t&>().reserve(value.size());
+        for (const auto& item : value) {
+            out.emplace_back(json::object());
+            schema.serialize(&item, out.back());
+        }
+        return true;
+    }
+
+    static void deserialize(const json& in, void* field) {
+        if (in.is_array()) {
+            std::vector<T>& value = *static_cast<std::vector<T>*>(field);
+            value.clear();
+            value.reserve(in.size());
+            for (const auto& item : in) {
+                if (item.is_object()) {
+                    value.emplace_back();
+                    value.back().fromJsonNode(item);
+                }
             }
         }
-    };
+    }
+
+    static const ClassSchema& schema() {
+        return T::schema();
+    }
+
+    static void clearElements(void* field) {
+        static_cast<std::vector<T>*>(field)->clear();
+    }
+
+    static void* appendElement(void* field) {
+        std::vector<T>& value = *static_cast<std::vector<T>*>(field);
+        value.emplace_back();
+        return &value.back();
+    }
+
+    static const PropertyTypeInfo* typeInfo() {
+        static const PropertyTypeInfo info = { &serialize, &deserialize, &schema, &clearElements, &appendElement };
+        return &info;
+    }
+};
 
-    //特化uint64_t
-    template<>
-    class PropertySerializer<uint64_t> {
-    public:
-        static void serialize(json& obj, const std::string& key, const uint64_t& value) {
-            obj[key] = value;
+#ifndef _WIN32
+// 只读映射整个文件, 析构时解除映射; 按顺序读取提示内核预读, 解析直接读映射区, 不复制到std::string
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) : data(nullptr), size(0), opened(false) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
         }
 
-        static void deserialize(const json& obj, const std::string& key, uint64_t& value) {
-            if (obj.contains(key) && obj[key].is_number_unsigned()) {
-                value = obj[key].get<uint64_t>();
+        struct stat info;
+        if (fstat(fd, &info) == 0) {
+            size = static_cast<size_t>(info.st_size);
+            if (size == 0) {
+                opened = true;
+            } else {
+                void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped != MAP_FAILED) {
+                    madvise(mapped, size, MADV_SEQUENTIAL);
+                    data = static_cast<const char*>(mapped);
+                    opened = true;
+                } else {
+                    size = 0;
+                }
             }
         }
-    };
+        // 映射建立后即可关闭文件描述符
+        close(fd);
+    }
 
-    //特化JSONObject
-    template<>
-    class PropertySerializer<JSONSerializable> {
-    public:
-        static void serialize(json& obj, const std::string& key, const JSONSerializable& value) {
-            obj[key] = json::parse(value.toJson());
+    ~MappedFile() {
+        if (data) {
+            munmap(const_cast<char*>(data), size);
         }
+    }
 
-        static void deserialize(const json& obj, const std::string& key, JSONSerializable& value) {
-            if (obj.contains(key) && obj[key].is_object()) {
-                value = JSONSerializable::fromJsonStatic(obj[key].dump());
-            }
+    bool isOpen() const { return opened; }
+    const char* getData() const { return data; }
+    size_t getSize() const { return size; }
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    const char* data;
+    size_t size;
+    bool opened;
+};
+#endif
+
+// 多线程批量序列化时每个线程至少分到的元素个数, 元素更少时启动线程的开销超过并行的收益
+static const size_t kParallelChunkItems = 256;
+
+// 析构时join尚未结束的线程: 异常离开作用域时std::thread仍是joinable会调用std::terminate
+class JoiningThreads {
+public:
+    JoiningThreads() {}
+    JoiningThreads(const JoiningThreads&) = delete;
+    JoiningThreads& operator=(const JoiningThreads&) = delete;
+    ~JoiningThreads() { join(); }
+
+    void reserve(size_t count) { threads.reserve(count); }
+
+    // 启动线程执行function; 线程创建失败时抛出std::system_error, 已启动的线程仍由析构函数join
+    template<typename Function>
+    void start(Function&& function) { threads.emplace_back(std::forward<Function>(function)); }
+
+    void join() {
+        for (auto& thread : threads) {
+            if (thread.joinable()) thread.join();
         }
-    };
+        threads.clear();
+    }
 
-    //特化vector<JSONObject>
-    template<>
-    class PropertySerializer<std::vector<JSONSerializable>> {
-    public:
-        static void serialize(json& obj, const std::string& key, const std::vector<JSONSerializable>& value) {
-            json arr = json::array();
-            for (const auto& item : value) {
-                arr.push_back(json::parse(item.toJson()));
-            }
-            obj[key] = arr;
+private:
+    std::vector<std::thread> threads;
+};
+
+// SAX解码处理器: 由json::sax_parse驱动, 按属性表把事件直接写入目标对象, 不构建json树
+// 未注册的键及类型不符的子树整体跳过; 基本类型的取值规则与DOM路径相同
+class SchemaSaxHandler : public json_sax<json> {
+public:
+    SchemaSaxHandler(const ClassSchema& schema, void* object)
+        : rootSchema(schema), rootObject(object), skipDepth(0) {}
+
+    bool null() override {
+        return scalar(nullptr);
+    }
+
+    bool boolean(bool val) override {
+        const PropertyDescriptor* p = nullptr;
+        void* object = nullptr;
+        if (!take(p, object)) return false;
+        if (p && p->kind == kBoolProperty) p->field<bool>(object) = val;
+        return true;
+    }
+
+    bool number_integer(number_integer_t val) override {
+        return number(val, false);
+    }
+
+    bool number_unsigned(number_unsigned_t val) override {
+        return number(val, true);
+    }
+
+    bool number_float(number_float_t val, const string_t&) override {
+        const PropertyDescriptor* p = nullptr;
+        void* object = nullptr;
+        if (!take(p, object)) return false;
+        if (!p) return true;
+        if (p->kind == kDoubleProperty) {
+            p->field<double>(object) = val;
+        } else if (p->kind == kEnumProperty) {
+            ClassSchema::deserializeProperty(*p, json(val), object);
         }
+        return true;
+    }
 
-        static void deserialize(const json& obj, const std::string& key, std::vector<JSONSerializable>& value) {
-            if (obj.contains(key) && obj[key].is_array()) {
-                value.clear();
-                for (const auto& item : obj[key]) {
-                    value.push_back(JSONSerializable::fromJsonStatic(item.dump()));
-                }
-            }
+    bool string(string_t& val) override {
+        const PropertyDescriptor* p = nullptr;
+        void* object = nullptr;
+        if (!take(p, object)) return false;
+        if (!p) return true;
+        // 字符串由解析器持有且随后丢弃, 直接移动到字段
+        if (p->kind == kStringProperty) {
+            p->field<std::string>(object) = std::move(val);
+        } else if (p->kind == kEnumProperty) {
+            ClassSchema::deserializeProperty(*p, json(std::move(val)), object);
         }
-    };
+        return true;
+    }
 
-    // 添加枚举特化
-    template<typename T>
-    class PropertySerializer<T, typename std::enable_if<std::is_enum<T>::value>::type> {
-    public:
-        static void serialize(json& obj, const std::string& key, const T& value) {
-            EnumSerializer<T>::serialize(obj, key, value);
+    bool binary(binary_t&) override {
+        return scalar(nullptr);
+    }
+
+    bool start_object(std::size_t) override {
+        if (skipDepth > 0) {
+            ++skipDepth;
+            return true;
         }
-        
-        static void deserialize(const json& obj, const std::string& key, T& value) {
-            EnumSerializer<T>::deserialize(obj, key, value);
+        if (frames.empty()) {
+            Frame root = { &rootSchema, rootObject, nullptr, nullptr };
+            frames.push_back(root);
+            return true;
+        }
+
+        Frame& top = frames.back();
+        if (top.arrayInfo) {
+            Frame element = { top.schema, top.arrayInfo->appendElement(top.target), nullptr, nullptr };
+            frames.push_back(element);
+            return true;
         }
+
+        const PropertyDescriptor* p = top.pending;
+        top.pending = nullptr;
+        if (p && p->kind == kObjectProperty) {
+            Frame nested = { &p->typeInfo->schema(), static_cast<char*>(top.target) + p->offset, nullptr, nullptr };
+            frames.push_back(nested);
+        } else {
+            skipDepth = 1;
+        }
+        return true;
+    }
+
+    bool key(string_t& val) override {
+        if (skipDepth == 0) {
+            Frame& top = frames.back();
+            top.pending = top.schema->findProperty(val);
+        }
+        return true;
+    }
+
+    bool end_object() override {
+        return end();
+    }
+
+    bool start_array(std::size_t) override {
+        if (skipDepth > 0) {
+            ++skipDepth;
+            return true;
+        }
+        // 根节点必须是对象
+        if (frames.empty()) return false;
+
+        Frame& top = frames.back();
+        const PropertyDescriptor* p = top.pending;
+        top.pending = nullptr;
+        if (!top.arrayInfo && p && p->kind == kObjectArrayProperty) {
+            void* field = static_cast<char*>(top.target) + p->offset;
+            p->typeInfo->clearElements(field);
+            Frame array = { &p->typeInfo->schema(), field, p->typeInfo, nullptr };
+            frames.push_back(array);
+        } else {
+            skipDepth = 1;
+        }
+        return true;
+    }
+
+    bool end_array() override {
+        return end();
+    }
+
+    // 与json::parse一致, 语法错误时抛出异常
+    bool parse_error(std::size_t, const std::string&, const detail::exception& ex) override {
+        if (const auto* error = dynamic_cast<const json::parse_error*>(&ex)) {
+            throw *error;
+        }
+        throw ex;
+    }
+
+private:
+    struct Frame {
+        const ClassSchema* schema;          // 对象帧: 对象自身的属性表; 数组帧: 元素的属性表
+        void* target;                       // 对象, 或数组帧中的std::vector字段
+        const PropertyTypeInfo* arrayInfo;  // 非空表示数组帧
+        const PropertyDescriptor* pending;  // 对象帧中最近一个键对应的属性
     };
 
+    // 取出当前标量对应的属性; 返回false表示根节点不是对象
+    bool take(const PropertyDescriptor*& p, void*& object) {
+        if (skipDepth > 0) return true;
+        if (frames.empty()) return false;
+
+        // 数组中的非对象元素与DOM路径一样忽略
+        Frame& top = frames.back();
+        p = top.pending;
+        object = top.target;
+        top.pending = nullptr;
+        return true;
+    }
+
+    template<typename Number>
+    bool number(Number val, bool isUnsigned) {
+        const PropertyDescriptor* p = nullptr;
+        void* object = nullptr;
+        if (!take(p, object)) return false;
+        if (!p) return true;
+
+        switch (p->kind) {
+        case kIntProperty:
+            p->field<int>(object) = static_cast<int>(val);
+            break;
+        case kUintProperty:
+            if (isUnsigned) p->field<unsigned int>(object) = static_cast<unsigned int>(val);
+            break;
+        case kUint64Property:
+            if (isUnsigned) p->field<uint64_t>(object) = static_cast<uint64_t>(val);
+            break;
+        case kDoubleProperty:
+            p->field<double>(object) = static_cast<double>(val);
+            break;
+        case kEnumProperty:
+            ClassSchema::deserializeProperty(*p, json(val), object);
+            break;
+        default:
+            break;
+        }
+        return true;
+    }
+
+    bool scalar(std::nullptr_t) {
+        const PropertyDescriptor* p = nullptr;
+        void* object = nullptr;
+        return take(p, object);
+    }
+
+    bool end() {
+        if (skipDepth > 0) {
+            --skipDepth;
+        } else {
+            frames.pop_back();
+        }
+        return true;
+    }
+
+    const ClassSchema& rootSchema;
+    void* rootObject;
+    std::vector<Frame> frames;
+    unsigned skipDepth;
+};
+
+
+// 基础序列化类
+// 属性在派生类构造函数中注册, 但只有构建属性表的原型对象会真正记录,
+// 普通实例不携带任何元数据; 注册必须在每个构造函数中无条件地以相同顺序进行,
+// 且只能注册对象自身的数据成员, 不能注册引用成员、静态变量或指针指向的存储
+// 属性表只按Derived构建, 因此Derived的子类(如Admin : User)不能再注册自己的成员, 否则构造时抛出std::logic_error;
+// 这样的子类按Derived的属性表序列化, 需要额外字段时改用组合
+template<typename Derived>
+class JSONSerializable {
+protected:
     // 添加注册枚举的便捷方法
     template<typename EnumType>
-    void registerEnum(const std::string& key, EnumType& value) {
+    void registerEnum(const char* key, EnumType& value) {
         static_assert(std::is_enum<EnumType>::value, "Type must be an enum");
         registerProperty(key, value);
     }
 
+    template<typename EnumType>
+    void registerEnum(const std::string& key, EnumType& value) {
+        registerEnum(key.c_str(), value);
+    }
+
     // 在 JSONSerializable 类中使用
     template<typename T>
-    void registerProperty(const std::string& key, T& value) {
-        using Serializer = PropertySerializer<typename std::remove_reference<T>::type>;
-        
-        serializers.push_back([key, &value](json& obj) {
-            Serializer::serialize(obj, key, value);
-        });
+    void registerProperty(const char* key, T& value) {
+        using Traits = PropertyTraits<typename std::remove_reference<T>::type>;
+        addProperty(key, value, Traits::kind, Traits::typeInfo());
+    }
 
-        deserializers.push_back([key, &value](const json& obj) {
-            Serializer::deserialize(obj, key, value);
-        });
+    template<typename T>
+    void registerProperty(const std::string& key, T& value) {
+        registerProperty(key.c_str(), value);
     }
 
     // 注册嵌套对象
     template<typename T>
-    void registerNestedObject(const std::string& key, T& value) {
+    void registerNestedObject(const char* key, T& value) {
         static_assert(std::is_base_of<JSONSerializable<T>, T>::value,
             "Nested object must inherit from JSONSerializable");
+        addProperty(key, value, kObjectProperty, NestedObjectTraits<T>::typeInfo());
+    }
 
-        serializers.push_back([key, &value](json& obj) {
-            obj[key] = json::parse(value.toJson());
-        });
-
-        deserializers.push_back([key, &value](const json& obj) {
-            if (obj.contains(key) && obj[key].is_object()) {
-                value = T::fromJsonStatic(obj[key].dump());
-            }
-        });
+    template<typename T>
+    void registerNestedObject(const std::string& key, T& value) {
+        registerNestedObject(key.c_str(), value);
     }
-    
+
     //注册嵌套对象数组
     template<typename T>
-    void registerNestedArray(const std::string& key, std::vector<T>& value) {
+    void registerNestedArray(const char* key, std::vector<T>& value) {
         static_assert(std::is_base_of<JSONSerializable<T>, T>::value,
             "Nested object must inherit from JSONSerializable");
+        addProperty(key, value, kObjectArrayProperty, NestedArrayTraits<T>::typeInfo());
+    }
+
+    template<typename T>
+    void registerNestedArray(const std::string& key, std::vector<T>& value) {
+        registerNestedArray(key.c_str(), value);
+    }
 
-        serializers.push_back([key, &value](json& obj) {
-            json arr = json::array();
-            for (const auto& item : value) {
-                arr.push_back(json::parse(item.toJson()));
+private:
+    // 正在构建的属性表, 仅在构造原型对象期间非空
+    static ClassSchema*& schemaBuilder() {
+        static thread_local ClassSchema* builder = nullptr;
+        return builder;
+    }
+
+    // 属性表只记录成员相对对象起始地址的偏移, 因此value必须是本对象的数据成员(可以是基类或嵌套结构中的成员)
+    // 引用成员所指的对象、静态变量或指针指向的存储不在对象内, 断言失败; 未启用断言时忽略该属性
+    // 从Derived的子类构造函数中注册时动态类型不是Derived, 其成员不在属性表中, 每个实例都抛出异常而不是丢弃这些成员
+    template<typename T>
+    void addProperty(const char* key, const T& value, PropertyKind kind, const PropertyTypeInfo* typeInfo) {
+        if (typeid(*this) != typeid(Derived)) {
+            throw std::logic_error(std::string("Classes derived from a serializable type cannot register members: ") + key);
+        }
+
+        ClassSchema* schema = schemaBuilder();
+        if (!schema) return;
+
+        const uintptr_t base = reinterpret_cast<uintptr_t>(static_cast<const Derived*>(this));
+        const uintptr_t member = reinterpret_cast<uintptr_t>(&value);
+        const bool inside = member >= base && sizeof(T) <= sizeof(Derived) && member - base <= sizeof(Derived) - sizeof(T);
+        assert(inside && "Only data members of the object itself can be registered");
+        if (!inside) return;
+
+        schema->addProperty(key, static_cast<size_t>(member - base), kind, typeInfo);
+    }
+
+    // 在chunkCount个线程上执行task(chunk), 第0块在调用线程上执行
+    // 全部线程结束后重新抛出第一个task抛出的异常; 线程创建失败时等已启动的线程结束后抛出std::system_error
+    template<typename Task>
+    static void runChunks(size_t chunkCount, const Task& task) {
+        std::mutex mutex;
+        std::exception_ptr failure;
+        auto run = [&](size_t chunk) {
+            try {
+                task(chunk);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!failure) failure = std::current_exception();
             }
-            obj[key] = arr;
-        });
+        };
 
-        deserializers.push_back([key, &value](const json& obj) {
-            if (obj.contains(key) && obj[key].is_array()) {
-                value.clear();
-                for (const auto& item : obj[key]) {
-                    value.push_back(T::fromJsonStatic(item.dump()));
-                }
+        {
+            JoiningThreads workers;
+            workers.reserve(chunkCount - 1);
+            for (size_t chunk = 1; chunk < chunkCount; chunk++) {
+                workers.start([&run, chunk] { run(chunk); });
             }
-        });
+            run(0);
+        }
+        if (failure) std::rethrow_exception(failure);
+    }
+
+    // 构造一个原型对象, 由其构造函数中的注册调用填充属性表
+    static bool buildSchema(ClassSchema& schema) {
+        struct BuilderScope {
+            explicit BuilderScope(ClassSchema* schema) { schemaBuilder() = schema; }
+            ~BuilderScope() { schemaBuilder() = nullptr; }
+        } scope(&schema);
+
+        {
+            Derived prototype;
+            (void)prototype;
+        }
+        schema.buildIndex();
+        return true;
     }
 
 public:
     virtual ~JSONSerializable() = default;
 
+    // 类型共享的属性表, 首次调用时线程安全地构建
+    static const ClassSchema& schema() {
+        static ClassSchema instance;
+        static const bool built = buildSchema(instance);
+        (void)built;
+        return instance;
+    }
+
     // 序列化接口
     virtual std::string toJson() const {
         json obj;
-        for (const auto& serializer : serializers) {
-            serializer(obj);
-        }
+        schema().serialize(static_cast<const Derived*>(this), obj);
         return obj.dump();
     }
 
     // 反序列化接口
     virtual bool fromJson(const std::string& jsonStr) {
         json obj = json::parse(jsonStr);
-        for (const auto& deserializer : deserializers) {
-            deserializer(obj);
+        return fromJsonNode(obj);
+    }
+
+    // 按长度解析, 不要求以'\0'结尾, 可直接传入从socket或mmap得到的字节
+    bool fromJson(const char* data, size_t length) {
+        json obj = json::parse(data, data + length);
+        return fromJsonNode(obj);
+    }
+
+#ifndef _WIN32
+    // 映射文件后直接解析, 不先读入std::string; 文件无法打开时返回false
+    bool fromJsonFile(const std::string& path) {
+        MappedFile file(path);
+        return file.isOpen() && fromJson(file.getData(), file.getSize());
+    }
+#endif
+
+#if __cplusplus >= 201703L
+    // 只匹配std::string_view本身, 字符串字面量仍选择const std::string&重载而不产生歧义
+    template<typename View, typename std::enable_if<std::is_same<View, std::string_view>::value, int>::type = 0>
+    bool fromJson(View jsonStr) {
+        return fromJson(jsonStr.data(), jsonStr.size());
+    }
+#endif
+
+    // SAX反序列化接口: 不构建json树, 解析事件直接写入字段
+    // 与fromJson结果一致; 但语法错误抛出异常时, 出错位置之前的字段已被更新
+    virtual bool fromJsonSax(const std::string& jsonStr) {
+        SchemaSaxHandler handler(schema(), static_cast<Derived*>(this));
+        return json::sax_parse(jsonStr, &handler);
+    }
+
+    // 从已解析的节点反序列化, 嵌套对象直接在父节点上解码
+    bool fromJsonNode(const json& obj) {
+        if (!obj.is_object()) {
+            return false;
         }
+        schema().deserialize(obj, static_cast<Derived*>(this));
         return true;
     }
 
@@ -337,6 +992,82 @@ public:
         obj.fromJson(jsonStr);
         return obj;
     }
+
+    // 批量接口: 整个集合对应一个JSON数组, 所有元素共用一个json树
+    static std::string toJsonArray(const std::vector<Derived>& items) {
+        json arr;
+        NestedArrayTraits<Derived>::serialize(&items, arr);
+        return arr.dump();
+    }
+
+    // 多线程批量序列化, 输出与toJsonArray逐字节一致; threadCount为0时使用硬件线程数
+    // 集合按线程数分块, 每块至少kParallelChunkItems个元素, 不足两块时在调用线程上顺序输出;
+    // 各块在工作线程中输出到自己的缓冲区; 再按各块大小的前缀和算出偏移, 第二轮并行把各块复制到一次分配好大小的out中
+    static void toJsonArrayParallel(const std::vector<Derived>& items, std::string& out, unsigned threadCount = 0) {
+        if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+        const size_t chunkCount = std::min<size_t>(threadCount, items.size() / kParallelChunkItems);
+        if (chunkCount <= 1) {
+            out = toJsonArray(items);
+            return;
+        }
+
+        // 各块并行输出, 块内元素以逗号分隔
+        std::vector<std::string> chunks(chunkCount);
+        runChunks(chunkCount, [&](size_t chunk) {
+            const ClassSchema& properties = schema();
+            std::string& buffer = chunks[chunk];
+            const size_t begin = items.size() * chunk / chunkCount;
+            const size_t end = items.size() * (chunk + 1) / chunkCount;
+            for (size_t i = begin; i < end; i++) {
+                if (i != begin) buffer += ',';
+                json obj = json::object();
+                properties.serialize(&items[i], obj);
+                buffer += obj.dump();
+            }
+        });
+
+        // 前缀和: 块chunk之前是'['与前面各块, 各块之间以逗号分隔
+        std::vector<size_t> offsets(chunkCount + 1);
+        offsets[0] = 1;
+        for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+            offsets[chunk + 1] = offsets[chunk] + chunks[chunk].size() + 1;
+        }
+        out.resize(offsets[chunkCount]);
+        char* target = &out[0];
+        target[0] = '[';
+        runChunks(chunkCount, [&](size_t chunk) {
+            memcpy(target + offsets[chunk], chunks[chunk].data(), chunks[chunk].size());
+            target[offsets[chunk + 1] - 1] = chunk + 1 < chunkCount ? ',' : ']';
+        });
+    }
+
+    static std::string toJsonArrayParallel(const std::vector<Derived>& items, unsigned threadCount = 0) {
+        std::string out;
+        toJsonArrayParallel(items, out, threadCount);
+        return out;
+    }
+
+    // 解析JSON数组并替换items的内容, 非对象元素被忽略; 根节点不是数组时返回false且items不变
+    static bool fromJsonArray(const std::string& jsonStr, std::vector<Derived>& items) {
+        return fromJsonArray(jsonStr.data(), jsonStr.size(), items);
+    }
+
+    static bool fromJsonArray(const char* data, size_t length, std::vector<Derived>& items) {
+        json arr = json::parse(data, data + length);
+        if (!arr.is_array()) {
+            return false;
+        }
+
+        NestedArrayTraits<Derived>::deserialize(arr, &items);
+        return true;
+    }
+
+#ifndef _WIN32
+    static bool fromJsonArrayFile(const std::string& path, std::vector<Derived>& items) {
+        MappedFile file(path);
+        return file.isOpen() && fromJsonArray(file.getData(), file.getSize(), items);
+    }
+#endif
 };
 
 }
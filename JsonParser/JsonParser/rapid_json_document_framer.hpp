@@ -0,0 +1,163 @@
+//
+//  rapid_json_document_framer.hpp
+//  JsonParser
+//
+//  Created by 朱继超 on 10/16/26.
+//
+
+#ifndef rapid_json_document_framer_hpp
+#define rapid_json_document_framer_hpp
+
+#include <stddef.h>
+#include <string>
+
+
+namespace rapidjson {
+namespace detail {
+
+// 顶层文档分帧器: 按任意大小的块送入字节, 找出首尾相接的各个顶层JSON文档的边界, 不解析文档内容
+// 分帧状态(嵌套深度、是否在字符串内)跨块保留; 完整位于一块内的文档直接指向该块,
+// 跨块的文档先复制到内部缓冲区; rapidjson与nlohmann的推送式解析器共用, 不依赖rapidjson的头文件
+class JsonDocumentFramer {
+public:
+    JsonDocumentFramer()
+        : state(kIdle), depth(0), inString(false), escape(false), consumed(0), documentOffset(0) {}
+
+    // 送入一段字节, 对其中结束的每个顶层文档调用onFrame(const char* data, size_t length)
+    // data在onFrame返回前有效; 调用onFrame时getDocumentOffset()为该文档的偏移
+    template<typename OnFrame>
+    void feed(const char* data, size_t length, OnFrame onFrame) {
+        size_t pos = 0;
+        while (pos < length) {
+            size_t begin = pos;
+            if (state == kIdle) {
+                while (pos < length && isSpace(data[pos])) ++pos;
+                if (pos == length) break;
+
+                begin = pos;
+                documentOffset = consumed + pos;
+                start(data[pos++]);
+            }
+
+            if (!scan(data, length, pos)) {
+                pending.append(data + begin, length - begin);
+                break;
+            }
+
+            if (pending.empty()) {
+                onFrame(data + begin, pos - begin);
+            } else {
+                pending.append(data + begin, pos - begin);
+                onFrame(pending.data(), pending.size());
+                pending.clear();
+            }
+            state = kIdle;
+        }
+        consumed += length;
+    }
+
+    // 输入结束: 把尚未结束的最后一个文档(结尾没有分隔符的标量, 或被截断的文档)交给onFrame并回到初始状态
+    template<typename OnFrame>
+    void finish(OnFrame onFrame) {
+        if (state != kIdle) {
+            onFrame(pending.data(), pending.size());
+        }
+        reset();
+    }
+
+    // 丢弃未结束的文档, 从下一个字节开始作为新的输入; 已送入的字节数继续累计
+    void reset() {
+        state = kIdle;
+        depth = 0;
+        inString = false;
+        escape = false;
+        pending.clear();
+    }
+
+    // 最近一个文档首字节在全部输入中的偏移
+    size_t getDocumentOffset() const { return documentOffset; }
+
+    // 尚未结束的文档已缓存的字节数
+    size_t getPendingSize() const { return pending.size(); }
+
+private:
+    enum State {
+        kIdle,      // 位于文档之间
+        kValue,     // 对象、数组或字符串内, 在对应的括号或引号处结束
+        kToken      // 数字、true等其他标量, 在空白或下一个文档的起始字符处结束
+    };
+
+    void start(char c) {
+        if (c == '{' || c == '[') {
+            state = kValue;
+            depth = 1;
+        } else if (c == '"') {
+            state = kValue;
+            depth = 0;
+            inString = true;
+        } else {
+            state = kToken;
+        }
+    }
+
+    // 从pos继续扫描当前文档, 文档结束时返回true且pos指向其后的第一个字节
+    bool scan(const char* data, size_t length, size_t& pos) {
+        if (state == kToken) {
+            while (pos < length) {
+                const char c = data[pos];
+                if (isSpace(c) || c == '{' || c == '[' || c == '"') return true;
+                ++pos;
+            }
+            return false;
+        }
+
+        while (pos < length) {
+            if (inString && !escape) {
+                // 字符串内只关心引号和反斜杠
+                while (pos < length && data[pos] != '"' && data[pos] != '\\') ++pos;
+                if (pos == length) break;
+            }
+
+            const char c = data[pos++];
+            if (inString) {
+                if (escape) {
+                    escape = false;
+                } else if (c == '\\') {
+                    escape = true;
+                } else if (c == '"') {
+                    inString = false;
+                    if (depth == 0) return true;
+                }
+                continue;
+            }
+
+            if (c == '"') {
+                inString = true;
+            } else if (c == '{' || c == '[') {
+                ++depth;
+            } else if ((c == '}' || c == ']') && --depth == 0) {
+                // 括号类型不匹配时也在此结束, 由解析报告错误
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool isSpace(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+
+    State state;
+    unsigned depth;
+    bool inString;
+    bool escape;
+    std::string pending;                            // 跨块文档已收到的部分
+
+    size_t consumed;
+    size_t documentOffset;
+};
+
+}
+}
+
+#endif /* rapid_json_document_framer_hpp */
@@ -0,0 +1,515 @@
+//
+//  rapid_json_lines.hpp
+//  JsonParser
+//
+//  Created by 朱继超 on 10/16/26.
+//
+
+#ifndef rapid_json_lines_hpp
+#define rapid_json_lines_hpp
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <thread>
+#include "rapid_json_wrapper.hpp"
+#include "rapidjson/filewritestream.h"
+#include "rapidjson/error/error.h"
+
+
+namespace rapidjson {
+
+// JSON Lines(NDJSON)写入器: 每条记录输出为一行, 经FileWriteStream缓冲后写入文件
+// 所有记录共用一个writer和一个缓冲区, 内存占用与记录条数无关
+template<typename Derived>
+class JsonLinesWriter {
+public:
+    static const size_t kDefaultBufferSize = 64 * 1024;
+
+    explicit JsonLinesWriter(std::FILE* fp, size_t bufferSize = kDefaultBufferSize)
+        : buffer(bufferSize), stream(fp, buffer.data(), buffer.size()), writer(stream) {}
+
+    JsonLinesWriter(const JsonLinesWriter&) = delete;
+    JsonLinesWriter& operator=(const JsonLinesWriter&) = delete;
+
+    ~JsonLinesWriter() { flush(); }
+
+    void write(const Derived& record) {
+        writer.Reset(stream);
+        record.toJsonWriter(writer);
+        stream.Put('\n');
+    }
+
+    // 把缓冲区中的内容写入文件, 不关闭文件
+    void flush() { stream.Flush(); }
+
+private:
+    std::vector<char> buffer;
+    rapidjson::FileWriteStream stream;
+    rapidjson::Writer<rapidjson::FileWriteStream> writer;
+};
+
+// JSON Lines(NDJSON)读取器: 逐行原位解析到一个复用的记录对象
+// 文件按块读入复用的缓冲区, 每行的DOM从复用的内存池分配, 内存占用只取决于最长的一行;
+// 格式错误的行被跳过并报告其位置, 不影响后续的行; 空白行直接忽略
+//
+// 用法:
+//     JsonLinesReader<User> reader(fp);
+//     while (reader.read() != JsonLinesReader<User>::kEnd) { ... }
+template<typename Derived>
+class JsonLinesReader {
+public:
+    static const size_t kDefaultBufferSize = 64 * 1024;
+    static const size_t kDefaultArenaSize = 64 * 1024;
+
+    enum Status {
+        kRecord,    // getRecord()为本行的内容
+        kBadLine,   // 本行无法解析或根节点不是对象, 位置见getLineOffset()等
+        kEnd        // 文件已读完
+    };
+
+    explicit JsonLinesReader(std::FILE* fp, size_t bufferSize = kDefaultBufferSize, size_t arenaSize = kDefaultArenaSize)
+        : fp(fp), buffer(bufferSize), readPos(0), readSize(0),
+          arenaBuffer(arenaSize), arena(arenaBuffer.data(), arenaBuffer.size()),
+          lineNumber(0), lineOffset(0), nextOffset(0),
+          parseError(rapidjson::kParseErrorNone), errorOffset(0) {}
+
+    JsonLinesReader(const JsonLinesReader&) = delete;
+    JsonLinesReader& operator=(const JsonLinesReader&) = delete;
+
+    // 读取下一条非空行; 每行都从默认构造的字段值开始解码, 字段已分配的容量被保留
+    // 借用字符串字段指向读取缓冲区, 在下一次read()之前有效
+    Status read() {
+        char* data;
+        size_t length;
+        while (readLine(data, length)) {
+            if (isBlank(data, length)) continue;
+
+            record = blank;
+            PooledDocument doc(&arena, kPooledStackCapacity, &arena);
+            BoundedInsituStringStream stream(data, length);
+            doc.ParseStream<rapidjson::kParseInsituFlag>(stream);
+
+            parseError = doc.GetParseError();
+            errorOffset = doc.GetErrorOffset();
+            const bool decoded = !doc.HasParseError() && record.fromValue(doc);
+            arena.Clear();
+            return decoded ? kRecord : kBadLine;
+        }
+        return kEnd;
+    }
+
+    // 逐条处理剩余的所有行, 返回成功解码的记录数
+    template<typename OnRecord, typename OnBadLine>
+    size_t forEach(OnRecord onRecord, OnBadLine onBadLine) {
+        size_t count = 0;
+        for (Status status = read(); status != kEnd; status = read()) {
+            if (status == kRecord) {
+                onRecord(record);
+                ++count;
+            } else {
+                onBadLine(*this);
+            }
+        }
+        return count;
+    }
+
+    Derived& getRecord() { return record; }
+
+    // 最近一行的行号(从1开始)与该行首字节在文件中的偏移
+    size_t getLineNumber() const { return lineNumber; }
+    size_t getLineOffset() const { return lineOffset; }
+
+    // 最近一行的解析错误及其在行内的偏移; 语法正确但根节点不是对象时为kParseErrorNone
+    rapidjson::ParseErrorCode getParseError() const { return parseError; }
+    size_t getErrorOffset() const { return errorOffset; }
+
+private:
+    // 取下一行(不含换行符), 整行位于读取缓冲区内时直接返回其中的位置, 否则拼接到line中
+    // FileReadStream逐字符读取, 且无法区分文件结束与'\0'字节, 因此这里直接按块fread
+    bool readLine(char*& data, size_t& length) {
+        line.clear();
+        bool partial = false;
+        for (;;) {
+            if (readPos == readSize) {
+                readSize = fread(buffer.data(), 1, buffer.size(), fp);
+                readPos = 0;
+                if (readSize == 0) {
+                    if (!partial) return false;
+                    // 最后一行没有换行符
+                    data = &line[0];
+                    length = line.size();
+                    beginLine(length);
+                    return true;
+                }
+            }
+
+            char* begin = buffer.data() + readPos;
+            const size_t available = readSize - readPos;
+            char* newline = static_cast<char*>(memchr(begin, '\n', available));
+            if (!newline) {
+                line.append(begin, available);
+                readPos = readSize;
+                partial = true;
+                continue;
+            }
+
+            const size_t count = static_cast<size_t>(newline - begin);
+            readPos += count + 1;
+            if (partial) {
+                line.append(begin, count);
+                data = &line[0];
+                length = line.size();
+            } else {
+                data = begin;
+                length = count;
+            }
+            beginLine(length + 1);
+            return true;
+        }
+    }
+
+    void beginLine(size_t consumed) {
+        ++lineNumber;
+        lineOffset = nextOffset;
+        nextOffset += consumed;
+    }
+
+    static bool isBlank(const char* data, size_t length) {
+        for (size_t i = 0; i < length; i++) {
+            if (data[i] != ' ' && data[i] != '\t' && data[i] != '\r') return false;
+        }
+        return true;
+    }
+
+    std::FILE* fp;
+    std::vector<char> buffer;
+    size_t readPos;
+    size_t readSize;
+    std::string line;                               // 跨越读取缓冲区边界的行
+
+    std::vector<char> arenaBuffer;
+    rapidjson::MemoryPoolAllocator<> arena;         // 每行解析后Clear, 只保留arenaBuffer
+
+    Derived record;
+    const Derived blank;
+
+    size_t lineNumber;
+    size_t lineOffset;
+    size_t nextOffset;
+    rapidjson::ParseErrorCode parseError;
+    size_t errorOffset;
+};
+
+// 并行JSON Lines导入: 输入在换行处切成若干块, 工作线程把每块的各行解码为一批记录后交给consumer
+// 每个线程有自己的批次和内存池; consumer在锁内逐个调用, 不需要线程安全, 可以移走batch.records
+template<typename Derived>
+class JsonLinesIngest {
+public:
+    static const size_t kDefaultChunkSize = 1024 * 1024;
+    static const size_t kArenaSize = 64 * 1024;
+
+    // 一块输入解码得到的记录
+    struct Batch {
+        size_t chunkIndex;                      // 块在整个输入中的序号, 从0开始
+        size_t offset;                          // 块首字节在整个输入中的偏移
+        std::vector<Derived> records;
+        std::vector<size_t> badLineOffsets;     // 无法解析或根节点不是对象的行的首字节偏移
+    };
+
+    struct Options {
+        unsigned threadCount;   // 0表示硬件线程数
+        size_t chunkSize;       // 每块的大致字节数, 块延伸到其后的第一个换行处
+        bool preserveOrder;     // true时按块在输入中的顺序交付, 否则按解码完成的顺序交付
+
+        Options() : threadCount(0), chunkSize(kDefaultChunkSize), preserveOrder(true) {}
+    };
+
+    struct Result {
+        size_t records;
+        size_t badLines;
+        size_t chunks;
+    };
+
+    // 导入内存中的整段输入
+    template<typename Consumer>
+    static Result ingest(const char* data, size_t length, Consumer consumer, const Options& options = Options()) {
+        Result result = { 0, 0, 0 };
+        ingestRange(data, length, 0, consumer, options, result);
+        return result;
+    }
+
+#ifndef _WIN32
+    // 导入映射的文件: 各线程直接读映射区, 不经过读缓冲窗口
+    template<typename Consumer>
+    static Result ingest(const rapidjson::MappedFile& file, Consumer consumer, const Options& options = Options()) {
+        return ingest(file.getData(), file.getSize(), consumer, options);
+    }
+#endif
+
+    // 导入文件: 按threadCount * chunkSize大小的窗口读入, 窗口末尾不完整的行留到下一个窗口
+    // 读线程在当前窗口解码的同时读入下一个窗口, 因此同时占用两个窗口的内存
+    template<typename Consumer>
+    static Result ingestFile(std::FILE* fp, Consumer consumer, const Options& options = Options()) {
+        Result result = { 0, 0, 0 };
+        WindowReader reader(fp, std::max<size_t>(threadCountOf(options) * options.chunkSize, 4096));
+        for (;;) {
+            const Window& window = reader.next();
+            ingestRange(window.data.data(), window.length, window.offset, consumer, options, result);
+            if (window.last) return result;
+            reader.release();
+        }
+    }
+
+private:
+    static unsigned threadCountOf(const Options& options) {
+        return options.threadCount ? options.threadCount : std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    static const char* lastNewline(const char* data, size_t length) {
+        for (size_t i = length; i > 0; i--) {
+            if (data[i - 1] == '\n') return data + i - 1;
+        }
+        return nullptr;
+    }
+
+    struct Window {
+        std::vector<char> data;
+        size_t length;                          // 完整的行的字节数, 其后是留给下一个窗口的不完整的行
+        size_t filled;
+        size_t offset;                          // 窗口首字节在文件中的偏移
+        bool last;                              // 文件已读完, length包括最后一行
+        bool ready;                             // 已读好, 等待或正在解码
+    };
+
+    // 读线程: 两个窗口轮流使用, 一个解码时读入另一个; 窗口按文件中的顺序交付
+    class WindowReader {
+    public:
+        WindowReader(std::FILE* fp, size_t windowSize) : fp(fp), consumed(0), stopped(false) {
+            for (Window& window : windows) {
+                window.data.resize(windowSize);
+                window.length = window.filled = window.offset = 0;
+                window.last = window.ready = false;
+            }
+            thread = std::thread([this] { run(); });
+        }
+
+        WindowReader(const WindowReader&) = delete;
+        WindowReader& operator=(const WindowReader&) = delete;
+
+        ~WindowReader() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopped = true;
+            }
+            changed.notify_all();
+            thread.join();
+        }
+
+        // 等待下一个窗口读好; 读线程失败时重新抛出其异常
+        const Window& next() {
+            std::unique_lock<std::mutex> lock(mutex);
+            Window& window = windows[consumed % 2];
+            changed.wait(lock, [&] { return window.ready || failure; });
+            if (failure) std::rethrow_exception(failure);
+            return window;
+        }
+
+        // next()返回的窗口已解码完, 可以重新读入
+        void release() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                windows[consumed++ % 2].ready = false;
+            }
+            changed.notify_all();
+        }
+
+    private:
+        void run() {
+            try {
+                const Window* previous = nullptr;
+                for (size_t index = 0; ; index++) {
+                    Window& window = windows[index % 2];
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        changed.wait(lock, [&] { return !window.ready || stopped; });
+                        if (stopped) return;
+                    }
+
+                    // 上一个窗口末尾不完整的行; 上一个窗口可能正在解码, 这里只读取它
+                    window.filled = 0;
+                    window.offset = 0;
+                    if (previous) {
+                        const size_t carried = previous->filled - previous->length;
+                        if (window.data.size() < carried * 2) window.data.resize(carried * 2);
+                        memcpy(window.data.data(), previous->data.data() + previous->length, carried);
+                        window.filled = carried;
+                        window.offset = previous->offset + previous->length;
+                    }
+                    fill(window);
+
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        window.ready = true;
+                    }
+                    changed.notify_all();
+                    if (window.last) return;
+                    previous = &window;
+                }
+            } catch (...) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    failure = std::current_exception();
+                }
+                changed.notify_all();
+            }
+        }
+
+        // 读到窗口中至少有一个换行或文件结束
+        void fill(Window& window) {
+            for (;;) {
+                const size_t read = fread(window.data.data() + window.filled, 1, window.data.size() - window.filled, fp);
+                window.filled += read;
+                if (read == 0) {
+                    // 最后一行没有换行符
+                    window.length = window.filled;
+                    window.last = true;
+                    return;
+                }
+
+                const char* last = lastNewline(window.data.data(), window.filled);
+                if (last) {
+                    window.length = static_cast<size_t>(last - window.data.data()) + 1;
+                    window.last = false;
+                    return;
+                }
+
+                // 窗口内没有完整的行, 扩大窗口继续读
+                if (window.filled == window.data.size()) window.data.resize(window.data.size() * 2);
+            }
+        }
+
+        std::FILE* fp;
+        Window windows[2];
+        size_t consumed;                        // 已解码完的窗口数
+        bool stopped;
+        std::exception_ptr failure;
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::thread thread;
+    };
+
+    // 解码一段完整的行, baseOffset为data在整个输入中的偏移, 块序号接着result.chunks继续编号
+    template<typename Consumer>
+    static void ingestRange(const char* data, size_t length, size_t baseOffset,
+                            Consumer& consumer, const Options& options, Result& result) {
+        if (length == 0) return;
+
+        // 在chunkSize之后的第一个换行处切块
+        std::vector<size_t> bounds(1, 0);
+        while (bounds.back() < length) {
+            const size_t target = bounds.back() + std::max<size_t>(options.chunkSize, 1);
+            if (target >= length) {
+                bounds.push_back(length);
+                break;
+            }
+            const char* newline = static_cast<const char*>(memchr(data + target, '\n', length - target));
+            bounds.push_back(newline ? static_cast<size_t>(newline - data) + 1 : length);
+        }
+
+        // 在启动工作线程前构建属性表, 并让构造函数中的一次性注册(如枚举名称)在当前线程完成
+        Derived::schema();
+
+        const size_t chunkCount = bounds.size() - 1;
+        const size_t firstChunk = result.chunks;
+        const size_t threadCount = std::min<size_t>(threadCountOf(options), chunkCount);
+
+        std::atomic<size_t> nextChunk(0);
+        std::mutex mutex;
+        std::condition_variable delivered;
+        size_t deliveredCount = 0;
+        std::exception_ptr failure;
+
+        // 解码或consumer失败后其余线程不再交付新的批次
+        auto work = [&]() {
+            try {
+                Batch batch;
+                std::vector<char> arenaBuffer(kArenaSize);
+                rapidjson::MemoryPoolAllocator<> arena(arenaBuffer.data(), arenaBuffer.size());
+
+                for (size_t chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++) {
+                    batch.chunkIndex = firstChunk + chunk;
+                    batch.offset = baseOffset + bounds[chunk];
+                    batch.records.clear();
+                    batch.badLineOffsets.clear();
+                    decodeChunk(data + bounds[chunk], bounds[chunk + 1] - bounds[chunk], batch, arena);
+
+                    std::unique_lock<std::mutex> lock(mutex);
+                    if (options.preserveOrder) {
+                        delivered.wait(lock, [&] { return deliveredCount == chunk || failure; });
+                    }
+                    if (failure) return;
+
+                    consumer(batch);
+                    result.records += batch.records.size();
+                    result.badLines += batch.badLineOffsets.size();
+                    ++deliveredCount;
+                    delivered.notify_all();
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!failure) failure = std::current_exception();
+                delivered.notify_all();
+            }
+        };
+
+        {
+            JoiningThreads workers;
+            workers.reserve(threadCount - 1);
+            for (size_t i = 1; i < threadCount; i++) {
+                workers.start(work);
+            }
+            work();
+        }
+
+        result.chunks += chunkCount;
+        if (failure) std::rethrow_exception(failure);
+    }
+
+    static void decodeChunk(const char* data, size_t length, Batch& batch, rapidjson::MemoryPoolAllocator<>& arena) {
+        const char* end = data + length;
+        for (const char* line = data; line < end; ) {
+            const char* newline = static_cast<const char*>(memchr(line, '\n', static_cast<size_t>(end - line)));
+            const char* lineEnd = newline ? newline : end;
+
+            if (!isBlank(line, lineEnd)) {
+                batch.records.emplace_back();
+                PooledDocument doc(&arena, kPooledStackCapacity, &arena);
+                rapidjson::MemoryStream stream(line, static_cast<size_t>(lineEnd - line));
+                doc.ParseStream<rapidjson::kParseDefaultFlags, rapidjson::UTF8<> >(stream);
+                if (doc.HasParseError() || !batch.records.back().fromValue(doc, false)) {
+                    batch.records.pop_back();
+                    batch.badLineOffsets.push_back(batch.offset + static_cast<size_t>(line - data));
+                }
+                arena.Clear();
+            }
+            line = lineEnd + 1;
+        }
+    }
+
+    static bool isBlank(const char* begin, const char* end) {
+        for (const char* c = begin; c < end; c++) {
+            if (*c != ' ' && *c != '\t' && *c != '\r') return false;
+        }
+        return true;
+    }
+};
+
+}
+
+#endif /* rapid_json_lines_hpp */
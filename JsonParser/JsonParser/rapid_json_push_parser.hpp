@@ -0,0 +1,118 @@
+//
+//  rapid_json_push_parser.hpp
+//  JsonParser
+//
+//  Created by 朱继超 on 10/16/26.
+//
+
+#ifndef rapid_json_push_parser_hpp
+#define rapid_json_push_parser_hpp
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "rapid_json_wrapper.hpp"
+#include "rapid_json_document_framer.hpp"
+#include "rapidjson/error/error.h"
+
+
+namespace rapidjson {
+
+// 推送式解析器: 按任意大小的块送入字节, 每结束一个顶层文档即解码为Derived并交给回调
+// 适用于被拆分到多个网络包中的消息, 以及首尾相接、没有分隔符的多个文档
+// 由JsonDocumentFramer找出文档边界后再完整解析该文档, 因此每个字节先分帧、再解析;
+// 完整位于一块内的文档直接从该块解析, 跨块的文档先复制到分帧器的缓冲区; 每个文档的DOM从复用的内存池分配
+//
+// 用法:
+//     JsonPushParser<User> parser;
+//     parser.feed(packet, size, [](User& user) { ... }, [](const JsonPushParser<User>& p) { ... });
+//     parser.finish(...);    // 输入结束时处理最后一个未结束的文档
+template<typename Derived>
+class JsonPushParser {
+public:
+    static const size_t kDefaultArenaSize = 64 * 1024;
+
+    explicit JsonPushParser(size_t arenaSize = kDefaultArenaSize)
+        : arenaBuffer(arenaSize), arena(arenaBuffer.data(), arenaBuffer.size()),
+          parseError(rapidjson::kParseErrorNone), errorOffset(0) {}
+
+    JsonPushParser(const JsonPushParser&) = delete;
+    JsonPushParser& operator=(const JsonPushParser&) = delete;
+
+    // 送入一段字节, 对其中结束的每个顶层文档调用onDocument(Derived&)或onBadDocument(const JsonPushParser&)
+    // 无法解析或根节点不是对象的文档被跳过, 不影响后续文档; 返回成功解码的文档数
+    // 借用字符串字段指向内存池, 在下一个文档解码之前有效
+    template<typename OnDocument, typename OnBadDocument>
+    size_t feed(const char* data, size_t length, OnDocument onDocument, OnBadDocument onBadDocument) {
+        size_t count = 0;
+        framer.feed(data, length, [&](const char* document, size_t size) {
+            count += deliver(document, size, onDocument, onBadDocument);
+        });
+        return count;
+    }
+
+    // 输入结束: 解码尚未结束的最后一个文档(结尾没有分隔符的标量, 或被截断的文档)并回到初始状态
+    // 返回成功解码的文档数
+    template<typename OnDocument, typename OnBadDocument>
+    size_t finish(OnDocument onDocument, OnBadDocument onBadDocument) {
+        size_t count = 0;
+        framer.finish([&](const char* document, size_t size) {
+            count += deliver(document, size, onDocument, onBadDocument);
+        });
+        return count;
+    }
+
+    // 丢弃未结束的文档, 从下一个字节开始作为新的输入; 已送入的字节数继续累计
+    void reset() { framer.reset(); }
+
+    Derived& getRecord() { return record; }
+
+    // 最近一个文档首字节在全部输入中的偏移
+    size_t getDocumentOffset() const { return framer.getDocumentOffset(); }
+
+    // 尚未结束的文档已缓存的字节数
+    size_t getPendingSize() const { return framer.getPendingSize(); }
+
+    // 最近一个文档的解析错误及其在文档内的偏移; 语法正确但根节点不是对象时为kParseErrorNone
+    rapidjson::ParseErrorCode getParseError() const { return parseError; }
+    size_t getErrorOffset() const { return errorOffset; }
+
+private:
+    template<typename OnDocument, typename OnBadDocument>
+    size_t deliver(const char* data, size_t length, OnDocument& onDocument, OnBadDocument& onBadDocument) {
+        if (decode(data, length)) {
+            onDocument(record);
+            return 1;
+        }
+        onBadDocument(*this);
+        return 0;
+    }
+
+    // 每个文档都从默认构造的字段值开始解码, 字段已分配的容量被保留
+    bool decode(const char* data, size_t length) {
+        arena.Clear();
+        record = blank;
+        PooledDocument doc(&arena, kPooledStackCapacity, &arena);
+        rapidjson::MemoryStream stream(data, length);
+        doc.ParseStream<rapidjson::kParseDefaultFlags, rapidjson::UTF8<> >(stream);
+
+        parseError = doc.GetParseError();
+        errorOffset = doc.GetErrorOffset();
+        return !doc.HasParseError() && record.fromValue(doc);
+    }
+
+    rapidjson::detail::JsonDocumentFramer framer;
+
+    std::vector<char> arenaBuffer;
+    rapidjson::MemoryPoolAllocator<> arena;         // 每个文档解码前Clear, 只保留arenaBuffer
+
+    Derived record;
+    const Derived blank;
+
+    rapidjson::ParseErrorCode parseError;
+    size_t errorOffset;
+};
+
+}
+
+#endif /* rapid_json_push_parser_hpp */
@@ -9,15 +9,44 @@
 #define rapid_json_wrapper_hpp
 
 #include <stdio.h>
+#include <string.h>
 #include <iostream>
 #include <string>
 #include <vector>
-#include <functional>
+#include <deque>
+#include <algorithm>
+#include <unordered_map>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <exception>
+#include <stdexcept>
+#include <typeinfo>
 #include "rapidjson/document.h"
+#include "rapidjson/reader.h"
 #include <type_traits>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
 #include "rapidjson/writer.h"
 #include "rapidjson/stringbuffer.h"
+#include "rapidjson/memorystream.h"
+#include "rapidjson/filereadstream.h"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#endif
 
+// 输出流换块等冷路径不内联, 使每个字符都要经过的Put保持短小
+#if defined(_MSC_VER)
+#define RAPID_JSON_WRAPPER_NOINLINE __declspec(noinline)
+#else
+#define RAPID_JSON_WRAPPER_NOINLINE __attribute__((noinline))
+#endif
 
 namespace rapidjson {
 
@@ -59,20 +88,46 @@ public:
         return serializer;
     }
 
+    // 通常在构造函数中调用, 可在多个线程中同时调用; 已注册过的名称直接返回
+    // 新的值在锁内加入当前映射表的副本后发布, 读取方无锁地读到完整的映射表;
+    // 旧的映射表保留到程序结束, nameOf返回的指针始终有效
     void registerValue(const std::string& name, EnumType value) {
-        stringToEnum[name] = value;
-        enumToString[static_cast<UnderlyingType>(value)] = name;
+        if (isRegistered(*current.load(std::memory_order_acquire), name, value)) return;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        const Maps& maps = *current.load(std::memory_order_relaxed);
+        if (isRegistered(maps, name, value)) return;
+
+        std::unique_ptr<Maps> next(new Maps(maps));
+        next->stringToEnum[name] = value;
+        next->enumToString[static_cast<UnderlyingType>(value)] = name;
+        snapshots.push_back(std::move(next));
+        current.store(snapshots.back().get(), std::memory_order_release);
+    }
+
+    // 按枚举值查找名称, 未注册时返回nullptr
+    static const std::string* nameOf(EnumType value) {
+        const Maps& maps = *instance().current.load(std::memory_order_acquire);
+        auto it = maps.enumToString.find(static_cast<UnderlyingType>(value));
+        return it != maps.enumToString.end() ? &it->second : nullptr;
+    }
+
+    // 按名称查找枚举值, 未注册时不修改value
+    static bool valueOf(const std::string& name, EnumType& value) {
+        const Maps& maps = *instance().current.load(std::memory_order_acquire);
+        auto it = maps.stringToEnum.find(name);
+        if (it == maps.stringToEnum.end()) return false;
+        value = it->second;
+        return true;
     }
 
     static void serialize(rapidjson::Value& obj,
                         const std::string& key,
                         const EnumType& value,
                         rapidjson::Document::AllocatorType& alloc) {
-        auto& inst = instance();
-        auto it = inst.enumToString.find(static_cast<UnderlyingType>(value));
-        if (it != inst.enumToString.end()) {
+        if (const std::string* name = nameOf(value)) {
             rapidjson::Value k(key.c_str(), alloc);
-            rapidjson::Value v(it->second.c_str(), alloc);
+            rapidjson::Value v(name->c_str(), alloc);
             obj.AddMember(k, v, alloc);
         }
     }
@@ -80,339 +135,1948 @@ public:
     static void deserialize(const rapidjson::Value& obj,
                           const std::string& key,
                           EnumType& value) {
-        auto& inst = instance();
         if (!obj.HasMember(key.c_str())) return;
-        
+
         const auto& jsonValue = obj[key.c_str()];
         if (jsonValue.IsString()) {
-            std::string strValue = jsonValue.GetString();
-            auto it = inst.stringToEnum.find(strValue);
-            if (it != inst.stringToEnum.end()) {
-                value = it->second;
-            }
+            valueOf(jsonValue.GetString(), value);
         } else if (jsonValue.IsNumber()) {
             value = static_cast<EnumType>(jsonValue.GetInt());
         }
     }
 
 private:
-    MapType stringToEnum;
-    ReverseMapType enumToString;
+    struct Maps {
+        MapType stringToEnum;
+        ReverseMapType enumToString;
+    };
+
+    EnumSerializer() : current(nullptr) {
+        snapshots.emplace_back(new Maps());
+        current.store(snapshots.back().get(), std::memory_order_release);
+    }
+
+    static bool isRegistered(const Maps& maps, const std::string& name, EnumType value) {
+        auto it = maps.stringToEnum.find(name);
+        return it != maps.stringToEnum.end() && it->second == value;
+    }
+
+    std::mutex mutex;                                   // 串行化registerValue
+    std::atomic<const Maps*> current;                   // 最新发布的映射表
+    std::vector<std::unique_ptr<Maps>> snapshots;       // 发布过的所有映射表
 };
 
 
-// 基础序列化类
-template<typename Derived>
-class JSONSerializable {
-protected:
-    // 存储属性描述器
-    std::vector<std::function<void(rapidjson::Value&, rapidjson::Document::AllocatorType&)>> serializers;
-    std::vector<std::function<void(const rapidjson::Value&)>> deserializers;
-
-    // 注册属性 - 基本类型
-    template<typename T, typename Enable = void>
-    class PropertySerializer {
-    public:
-        static void serialize(rapidjson::Value& obj, const std::string& key, const T& value,
-                              rapidjson::Document::AllocatorType& alloc);
-        static void deserialize(const rapidjson::Value& obj, const std::string& key, T& value);
-    };
+// 借用的字符串: 只记录指针和长度, 不拥有内存
+// 只由保留输入的接口填充(fromJsonInsitu、使用调用方内存池的fromJson、fromValue及原位SAX解析),
+// 指向的缓冲区、内存池或DOM必须比该字段活得久; 其它反序列化接口保持该字段不变
+class BorrowedString {
+public:
+    BorrowedString() : ptr(""), length(0) {}
+    BorrowedString(const char* data, size_t size) : ptr(data), length(size) {}
 
-    // 特化 std::string
-    template<>
-    class PropertySerializer<std::string> {
-    public:
-        static void serialize(rapidjson::Value& obj, const std::string& key, const std::string& value,
-            rapidjson::Document::AllocatorType& alloc) {
-            rapidjson::Value k(key.c_str(), alloc);
-            rapidjson::Value v(value.c_str(), alloc);
-            obj.AddMember(k, v, alloc);
-        }
+    const char* data() const { return ptr; }
+    size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+    std::string str() const { return std::string(ptr, length); }
+
+    bool operator==(const BorrowedString& rhs) const {
+        return length == rhs.length && memcmp(ptr, rhs.ptr, length) == 0;
+    }
+    bool operator!=(const BorrowedString& rhs) const { return !(*this == rhs); }
+
+private:
+    const char* ptr;
+    size_t length;
+};
+
+// 属性类型
+enum PropertyKind {
+    kStringProperty,
+    kBorrowedStringProperty,
+    kIntProperty,
+    kUintProperty,
+    kUint64Property,
+    kDoubleProperty,
+    kBoolProperty,
+    kEnumProperty,
+    kObjectProperty,
+    kObjectArrayProperty
+};
+
+class ClassSchema;
 
-        static void deserialize(const rapidjson::Value& obj, const std::string& key, std::string& value) {
-            if (obj.HasMember(key.c_str()) && obj[key.c_str()].IsString()) {
-                value = obj[key.c_str()].GetString();
+// 枚举、嵌套对象等需要类型信息的属性操作表, 每种类型只有一份
+struct PropertyTypeInfo {
+    // 将字段写入out, 返回false时不输出该属性
+    bool (*serialize)(const void* field, rapidjson::Value& out, rapidjson::Document::AllocatorType& alloc);
+    // borrow为true时输入的存储由调用方保留, 借用字符串可以指向它
+    void (*deserialize)(const rapidjson::Value& in, void* field, bool borrow);
+
+    // 以下供SAX解码与Writer直接输出使用, 不适用的项为nullptr
+    const ClassSchema& (*schema)();                             // 嵌套对象或数组元素的属性表
+    void (*clearElements)(void* field);                         // 清空嵌套数组
+    void* (*appendElement)(void* field);                        // 向嵌套数组追加一个默认构造的元素
+    size_t (*elementCount)(const void* field);                  // 嵌套数组元素个数
+    const void* (*elementAt)(const void* field, size_t index);  // 嵌套数组第index个元素
+    const std::string* (*enumName)(const void* field);          // 枚举名称, 未注册时为nullptr
+    void (*stringData)(const void* field, const char*& data, SizeType& length); // 借用字符串的内容
+};
+
+// 属性描述器, 同一类型的所有实例共享
+struct PropertyDescriptor {
+    const char* key;                    // 驻留在ClassSchema中的键
+    SizeType keyLength;
+    size_t offset;                      // 成员相对对象起始地址的偏移
+    PropertyKind kind;
+    const PropertyTypeInfo* typeInfo;   // 基本类型为nullptr
+
+    template<typename T>
+    const T& field(const void* object) const {
+        return *reinterpret_cast<const T*>(static_cast<const char*>(object) + offset);
+    }
+
+    template<typename T>
+    T& field(void* object) const {
+        return *reinterpret_cast<T*>(static_cast<char*>(object) + offset);
+    }
+};
+
+// 键到属性下标的最小完美哈希(hash-and-displace), 属性表构建完成后生成一次
+// 查找只需两次哈希和一次键比较, 与属性个数无关
+class PropertyIndex {
+public:
+    void build(const std::vector<PropertyDescriptor>& properties) {
+        size_t size = 1;
+        while (size < properties.size()) size <<= 1;
+        // 种子搜索失败的概率极低, 失败时加倍槽位重试
+        while (!tryBuild(properties, size)) size <<= 1;
+    }
+
+    // 返回可能匹配的属性下标, 没有候选时返回-1; 调用方需再比较键
+    int find(const char* key, SizeType keyLength) const {
+        if (slots.empty()) return -1;
+        int32_t d = displacements[hash(0, key, keyLength) & mask];
+        uint32_t slot = d < 0 ? static_cast<uint32_t>(-d - 1) : hash(static_cast<uint32_t>(d), key, keyLength) & mask;
+        return slots[slot];
+    }
+
+private:
+    static const uint32_t kMaxSeed = 1u << 16;
+
+    bool tryBuild(const std::vector<PropertyDescriptor>& properties, size_t size) {
+        mask = static_cast<uint32_t>(size - 1);
+        displacements.assign(size, 0);
+        slots.assign(size, -1);
+
+        // 第一级: 按种子0的哈希分桶, 重复注册的键只保留第一次
+        std::vector<std::vector<int>> buckets(size);
+        for (size_t i = 0; i < properties.size(); i++) {
+            const PropertyDescriptor& p = properties[i];
+            bool duplicate = false;
+            for (size_t j = 0; j < i && !duplicate; j++) {
+                duplicate = properties[j].keyLength == p.keyLength && memcmp(properties[j].key, p.key, p.keyLength) == 0;
             }
+            if (!duplicate) buckets[hash(0, p.key, p.keyLength) & mask].push_back(static_cast<int>(i));
         }
-    };
 
-    // 特化 int
-    template<>
-    class PropertySerializer<int> {
-    public:
-        static void serialize(rapidjson::Value& obj, const std::string& key, const int& value,
-            rapidjson::Document::AllocatorType& alloc) {
-            rapidjson::Value k(key.c_str(), alloc);
-            obj.AddMember(k, value, alloc);
-        }
+        // 第二级: 从大桶开始为每个桶寻找使其所有键落入空槽的种子
+        std::vector<size_t> order(size);
+        for (size_t b = 0; b < size; b++) order[b] = b;
+        std::stable_sort(order.begin(), order.end(), [&buckets](size_t a, size_t b) {
+            return buckets[a].size() > buckets[b].size();
+        });
+
+        std::vector<uint32_t> taken;
+        size_t next = 0;
+        for (size_t b : order) {
+            const std::vector<int>& bucket = buckets[b];
+            if (bucket.empty()) break;
 
-        static void deserialize(const rapidjson::Value& obj, const std::string& key, int& value) {
-            if (obj.HasMember(key.c_str()) && obj[key.c_str()].IsInt()) {
-                value = obj[key.c_str()].GetInt();
+            if (bucket.size() == 1) {
+                // 单键桶直接占用一个空槽, 以负数记录槽位
+                while (slots[next] != -1) next++;
+                slots[next] = bucket[0];
+                displacements[b] = -static_cast<int32_t>(next) - 1;
+                continue;
             }
-        }
-    };
-    
 
-    // 特化 double
-    template<>
-    class PropertySerializer<double> {
-    public:
-        static void serialize(rapidjson::Value& obj, const std::string& key, const double& value,
-            rapidjson::Document::AllocatorType& alloc) {
-            rapidjson::Value k(key.c_str(), alloc);
-            obj.AddMember(k, value, alloc);
+            uint32_t seed = 1;
+            for (; seed <= kMaxSeed; seed++) {
+                taken.clear();
+                for (int index : bucket) {
+                    const PropertyDescriptor& p = properties[index];
+                    uint32_t slot = hash(seed, p.key, p.keyLength) & mask;
+                    if (slots[slot] != -1 || std::find(taken.begin(), taken.end(), slot) != taken.end()) break;
+                    taken.push_back(slot);
+                }
+                if (taken.size() == bucket.size()) break;
+            }
+            if (seed > kMaxSeed) return false;
+
+            for (size_t k = 0; k < taken.size(); k++) slots[taken[k]] = bucket[k];
+            displacements[b] = static_cast<int32_t>(seed);
         }
+        return true;
+    }
 
-        static void deserialize(const rapidjson::Value& obj, const std::string& key, double& value) {
-            if (obj.HasMember(key.c_str()) && obj[key.c_str()].IsDouble()) {
-                value = obj[key.c_str()].GetDouble();
-            }
+    // 以种子扰动初值的FNV-1a; FNV结果的低位只取决于各字节的低位, 取槽位前再混合高位
+    static uint32_t hash(uint32_t seed, const char* key, SizeType keyLength) {
+        uint32_t h = 2166136261u ^ (seed * 0x9E3779B9u);
+        for (SizeType i = 0; i < keyLength; i++) {
+            h ^= static_cast<unsigned char>(key[i]);
+            h *= 16777619u;
         }
-    };
+        h ^= h >> 16;
+        h *= 0x85EBCA6Bu;
+        h ^= h >> 13;
+        return h;
+    }
 
-    // 特化 bool
-    template<>
-    class PropertySerializer<bool> {
-    public:
-        static void serialize(rapidjson::Value& obj, const std::string& key, const bool& value,
-            rapidjson::Document::AllocatorType& alloc) {
-            rapidjson::Value k(key.c_str(), alloc);
-            obj.AddMember(k, value, alloc);
+    std::vector<int32_t> displacements;     // 每个桶的种子, 负数表示单键桶的槽位
+    std::vector<int> slots;                 // 槽位到属性下标
+    uint32_t mask = 0;
+};
+
+// Writer输出字符串时需要转义的字节
+inline bool needsJsonEscape(unsigned char c) {
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+// 返回[p, end)中第一个需要转义的字节, 没有时返回end; 每次检查8个字节
+inline const char* findJsonEscape(const char* p, const char* end) {
+    const uint64_t ones = 0x0101010101010101ull;
+    const uint64_t highs = 0x8080808080808080ull;
+    for (; end - p >= 8; p += 8) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        const uint64_t quote = word ^ (ones * '"');
+        const uint64_t backslash = word ^ (ones * '\\');
+        // 某字节小于0x20或等于0时, 对应字节的最高位被置位
+        const uint64_t hit = ((word - ones * 0x20) & ~word) | ((quote - ones) & ~quote) | ((backslash - ones) & ~backslash);
+        if (hit & highs) break;
+    }
+    while (p != end && !needsJsonEscape(static_cast<unsigned char>(*p))) ++p;
+    return p;
+}
+
+// Writer输出的字符串字节数, 含两侧引号; \b等短转义占2字节, 其余控制字符按\u00XX占6字节
+inline size_t jsonStringSize(const char* data, size_t length) {
+    size_t size = length + 2;
+    const char* end = data + length;
+    for (const char* p = findJsonEscape(data, end); p != end; p = findJsonEscape(p + 1, end)) {
+        switch (*p) {
+            case '"': case '\\': case '\b': case '\t': case '\n': case '\f': case '\r':
+                size += 1;
+                break;
+            default:
+                size += 5;
+                break;
         }
+    }
+    return size;
+}
+
+// 十进制位数, 与misctest.cpp中CountDecimalDigit64_enroll4的做法相同
+inline size_t countDecimalDigits(uint64_t n) {
+    size_t count = 1;
+    while (n >= 10000) {
+        n /= 10000u;
+        count += 4;
+    }
+    if (n < 10) return count;
+    if (n < 100) return count + 1;
+    if (n < 1000) return count + 2;
+    return count + 3;
+}
+
+// Writer输出的整数字节数
+inline size_t jsonIntSize(int64_t i) {
+    return i < 0 ? 1 + countDecimalDigits(0 - static_cast<uint64_t>(i)) : countDecimalDigits(static_cast<uint64_t>(i));
+}
+
+// 浮点数的最短表示无法只凭位数推算, 在栈上的临时缓冲区中按Writer::WriteDouble相同的方式格式化后取长度
+inline size_t jsonDoubleSize(double d) {
+    char buffer[25];
+    return static_cast<size_t>(rapidjson::internal::dtoa(d, buffer) - buffer);
+}
+
+// 类型属性表: 每个Derived类型只构建一次, toJson/fromJson遍历该表
+class ClassSchema {
+public:
+    ClassSchema() = default;
+    ClassSchema(const ClassSchema&) = delete;
+    ClassSchema& operator=(const ClassSchema&) = delete;
+
+    void addProperty(const char* key, size_t offset, PropertyKind kind, const PropertyTypeInfo* typeInfo) {
+        // deque扩容不移动已有元素, 键的地址在整个生命周期内保持不变
+        keys.emplace_back(key);
+        PropertyDescriptor property = {
+            keys.back().c_str(), static_cast<SizeType>(keys.back().size()), offset, kind, typeInfo
+        };
+        properties.push_back(property);
+    }
+
+    const std::vector<PropertyDescriptor>& getProperties() const { return properties; }
 
-        static void deserialize(const rapidjson::Value& obj, const std::string& key, bool& value) {
-            if (obj.HasMember(key.c_str()) && obj[key.c_str()].IsBool()) {
-                value = obj[key.c_str()].GetBool();
+    // 按键查找属性, 未注册时返回nullptr
+    const PropertyDescriptor* findProperty(const char* key, SizeType keyLength) const {
+        if (properties.size() <= kLinearScanLimit) {
+            for (const auto& p : properties) {
+                if (p.keyLength == keyLength && memcmp(p.key, key, keyLength) == 0) {
+                    return &p;
+                }
             }
+            return nullptr;
         }
-    };
-    
-    //特化Unt
-    template<>
-    class PropertySerializer<unsigned int> {
-    public:
-        static void serialize(rapidjson::Value& obj, const std::string& key, const unsigned int& value,
-            rapidjson::Document::AllocatorType& alloc) {
-            rapidjson::Value k(key.c_str(), alloc);
-            obj.AddMember(k, value, alloc);
-        }
 
-        static void deserialize(const rapidjson::Value& obj, const std::string& key, unsigned int& value) {
-            if (obj.HasMember(key.c_str()) && obj[key.c_str()].IsUint()) {
-                value = obj[key.c_str()].GetUint();
+        int index = keyIndex.find(key, keyLength);
+        if (index < 0) return nullptr;
+
+        const PropertyDescriptor& p = properties[index];
+        return p.keyLength == keyLength && memcmp(p.key, key, keyLength) == 0 ? &p : nullptr;
+    }
+
+    // 所有属性注册完成后生成键索引; 属性较少时线性比较更快, 不生成索引
+    void buildIndex() {
+        if (properties.size() > kLinearScanLimit) keyIndex.build(properties);
+    }
+
+    // 按属性表将object写入obj
+    void serialize(const void* object, rapidjson::Value& obj, rapidjson::Document::AllocatorType& alloc) const {
+        for (const auto& p : properties) {
+            rapidjson::Value k(p.key, p.keyLength);
+            rapidjson::Value v;
+            switch (p.kind) {
+            case kStringProperty: {
+                const std::string& s = p.field<std::string>(object);
+                v.SetString(s.c_str(), static_cast<SizeType>(s.size()), alloc);
+                break;
             }
+            case kIntProperty:    v.SetInt(p.field<int>(object)); break;
+            case kUintProperty:   v.SetUint(p.field<unsigned int>(object)); break;
+            case kUint64Property: v.SetUint64(p.field<uint64_t>(object)); break;
+            case kDoubleProperty: v.SetDouble(p.field<double>(object)); break;
+            case kBoolProperty:   v.SetBool(p.field<bool>(object)); break;
+            default:
+                if (!p.typeInfo->serialize(static_cast<const char*>(object) + p.offset, v, alloc)) continue;
+                break;
+            }
+            obj.AddMember(k, v, alloc);
         }
-    };
-    
-    //特化UInt64
-    template<>
-    class PropertySerializer<uint64_t> {
-    public:
-        static void serialize(rapidjson::Value& obj, const std::string& key, const uint64_t& value,
-            rapidjson::Document::AllocatorType& alloc) {
-            rapidjson::Value k(key.c_str(), alloc);
-            obj.AddMember(k, value, alloc);
-        }
+    }
 
-        static void deserialize(const rapidjson::Value& obj, const std::string& key, uint64_t& value) {
-            if (obj.HasMember(key.c_str()) && obj[key.c_str()].IsUint64()) {
-                value = obj[key.c_str()].GetUint64();
+    // 按属性表把object的成员直接输出到writer, 不构建DOM; 输出与serialize后Accept逐字节一致
+    template<typename Writer>
+    void write(const void* object, Writer& writer) const {
+        for (const auto& p : properties) {
+            const void* field = static_cast<const char*>(object) + p.offset;
+            if (p.kind == kEnumProperty) {
+                const std::string* name = p.typeInfo->enumName(field);
+                if (!name) continue;
+                writer.Key(p.key, p.keyLength);
+                writer.String(name->c_str(), static_cast<SizeType>(name->size()));
+                continue;
             }
-        }
-    };
-    
-    //特化JSONObject
-    template<>
-    class PropertySerializer<JSONSerializable> {
-    public:
-        static void serialize(rapidjson::Value& obj, const std::string& key, const JSONSerializable& value,
-            rapidjson::Document::AllocatorType& alloc) {
-            rapidjson::Document subDoc;
-            subDoc.Parse(value.toJson().c_str());
-            rapidjson::Value k(key.c_str(), alloc);
-            obj.AddMember(k, subDoc, alloc);
-        }
 
-        static void deserialize(const rapidjson::Value& obj, const std::string& key, JSONSerializable& value) {
-            if (obj.HasMember(key.c_str()) && obj[key.c_str()].IsObject()) {
-                rapidjson::StringBuffer buffer;
-                rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-                obj[key.c_str()].Accept(writer);
-                value = JSONSerializable::fromJsonStatic(buffer.GetString());
+            writer.Key(p.key, p.keyLength);
+            switch (p.kind) {
+            case kStringProperty: {
+                const std::string& s = *static_cast<const std::string*>(field);
+                writer.String(s.c_str(), static_cast<SizeType>(s.size()));
+                break;
             }
-        }
-    };
-        
-    //特化vector<JSONObject>
-    template<>
-    class PropertySerializer<std::vector<JSONSerializable>> {
-    public:
-        static void serialize(rapidjson::Value& obj, const std::string& key, const std::vector<JSONSerializable>& value,
-            rapidjson::Document::AllocatorType& alloc) {
-            rapidjson::Value arr(rapidjson::kArrayType);
-            for (const auto& item : value) {
-                rapidjson::Document subDoc;
-                subDoc.Parse(item.toJson().c_str());
-                arr.PushBack(subDoc, alloc);
+            case kBorrowedStringProperty: {
+                const char* data;
+                SizeType length;
+                p.typeInfo->stringData(field, data, length);
+                writer.String(data, length);
+                break;
+            }
+            case kIntProperty:    writer.Int(*static_cast<const int*>(field)); break;
+            case kUintProperty:   writer.Uint(*static_cast<const unsigned int*>(field)); break;
+            case kUint64Property: writer.Uint64(*static_cast<const uint64_t*>(field)); break;
+            case kDoubleProperty: writer.Double(*static_cast<const double*>(field)); break;
+            case kBoolProperty:   writer.Bool(*static_cast<const bool*>(field)); break;
+            case kObjectProperty:
+                writer.StartObject();
+                p.typeInfo->schema().write(field, writer);
+                writer.EndObject();
+                break;
+            case kObjectArrayProperty: {
+                const ClassSchema& schema = p.typeInfo->schema();
+                const size_t count = p.typeInfo->elementCount(field);
+                writer.StartArray();
+                for (size_t i = 0; i < count; i++) {
+                    writer.StartObject();
+                    schema.write(p.typeInfo->elementAt(field, i), writer);
+                    writer.EndObject();
+                }
+                writer.EndArray();
+                break;
             }
+            default:
+                break;
+            }
+        }
+    }
 
-            rapidjson::Value k(key.c_str(), alloc);
-            obj.AddMember(k, arr, alloc);
-        }
-
-        static void deserialize(const rapidjson::Value& obj, const std::string& key, std::vector<JSONSerializable>& value) {
-            if (obj.HasMember(key.c_str()) && obj[key.c_str()].IsArray()) {
-                value.clear();
-                for (int i = 0; i < obj.Size(); i++) {
-                    const rapidjson::Value& item = obj[key.c_str()][i];
-                    if (item.IsObject()) {
-                        rapidjson::StringBuffer buffer;
-                        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-                        item.Accept(writer);
-                        value.push_back(JSONSerializable::fromJsonStatic(buffer.GetString()));
-                    }
+    // write输出的字节数(含对象两侧的括号), 不产生输出; 与write遍历相同的属性
+    size_t serializedSize(const void* object) const {
+        size_t size = 2;
+        size_t members = 0;
+        for (const auto& p : properties) {
+            const void* field = static_cast<const char*>(object) + p.offset;
+            size_t value = 0;
+            switch (p.kind) {
+            case kEnumProperty: {
+                const std::string* name = p.typeInfo->enumName(field);
+                if (!name) continue;
+                value = jsonStringSize(name->data(), name->size());
+                break;
+            }
+            case kStringProperty: {
+                const std::string& s = *static_cast<const std::string*>(field);
+                value = jsonStringSize(s.data(), s.size());
+                break;
+            }
+            case kBorrowedStringProperty: {
+                const char* data;
+                SizeType length;
+                p.typeInfo->stringData(field, data, length);
+                value = jsonStringSize(data, length);
+                break;
+            }
+            case kIntProperty:    value = jsonIntSize(*static_cast<const int*>(field)); break;
+            case kUintProperty:   value = countDecimalDigits(*static_cast<const unsigned int*>(field)); break;
+            case kUint64Property: value = countDecimalDigits(*static_cast<const uint64_t*>(field)); break;
+            case kDoubleProperty: value = jsonDoubleSize(*static_cast<const double*>(field)); break;
+            case kBoolProperty:   value = *static_cast<const bool*>(field) ? 4 : 5; break;
+            case kObjectProperty:
+                value = p.typeInfo->schema().serializedSize(field);
+                break;
+            case kObjectArrayProperty: {
+                const ClassSchema& schema = p.typeInfo->schema();
+                const size_t count = p.typeInfo->elementCount(field);
+                value = count > 0 ? count + 1 : 2;  // 方括号与元素间的逗号
+                for (size_t i = 0; i < count; i++) {
+                    value += schema.serializedSize(p.typeInfo->elementAt(field, i));
                 }
+                break;
+            }
+            default:
+                break;
             }
+            // 键、冒号与值
+            size += jsonStringSize(p.key, p.keyLength) + 1 + value;
+            ++members;
         }
-    };
-    
-    // 添加枚举特化
-    template<typename T>
-    class PropertySerializer<T, typename std::enable_if<std::is_enum<T>::value>::type> {
-    public:
-        static void serialize(rapidjson::Value& obj, const std::string& key, const T& value,
-                              rapidjson::Document::AllocatorType& alloc) {
-            EnumSerializer<T>::serialize(obj, key, value, alloc);
+        // 成员间的逗号
+        return members > 0 ? size + members - 1 : size;
+    }
+
+    // 遍历obj的成员一次并按键分发到属性, 缺失或类型不符的键保持字段不变; 重复的键以最后一个为准
+    // borrowStrings为false时obj的存储随调用结束释放, 借用字符串字段保持不变
+    void deserialize(const rapidjson::Value& obj, void* object, bool borrowStrings) const {
+        for (rapidjson::Value::ConstMemberIterator m = obj.MemberBegin(); m != obj.MemberEnd(); ++m) {
+            const PropertyDescriptor* p = findProperty(m->name.GetString(), m->name.GetStringLength());
+            if (!p) continue;
+
+            deserializeProperty(*p, m->value, object, borrowStrings);
         }
-        
-        static void deserialize(const rapidjson::Value& obj, const std::string& key, T& value) {
-            EnumSerializer<T>::deserialize(obj, key, value);
+    }
+
+    // 将单个值写入属性, 类型不符时保持字段不变; DOM与SAX解码共用
+    static void deserializeProperty(const PropertyDescriptor& p, const rapidjson::Value& v, void* object, bool borrowStrings) {
+        switch (p.kind) {
+        case kStringProperty:
+            if (v.IsString()) p.field<std::string>(object).assign(v.GetString(), v.GetStringLength());
+            break;
+        case kIntProperty:
+            if (v.IsInt()) p.field<int>(object) = v.GetInt();
+            break;
+        case kUintProperty:
+            if (v.IsUint()) p.field<unsigned int>(object) = v.GetUint();
+            break;
+        case kUint64Property:
+            if (v.IsUint64()) p.field<uint64_t>(object) = v.GetUint64();
+            break;
+        case kDoubleProperty:
+            if (v.IsDouble()) p.field<double>(object) = v.GetDouble();
+            break;
+        case kBoolProperty:
+            if (v.IsBool()) p.field<bool>(object) = v.GetBool();
+            break;
+        default:
+            p.typeInfo->deserialize(v, static_cast<char*>(object) + p.offset, borrowStrings);
+            break;
         }
-    };
-    
-    // 添加注册枚举的便捷方法
-    template<typename EnumType>
-    void registerEnum(const std::string& key, EnumType& value) {
-        static_assert(std::is_enum<EnumType>::value, "Type must be an enum");
-        registerProperty(key, value);
     }
 
-    // 在 JSONSerializable 类中使用
-    template<typename T>
-    void registerProperty(const std::string& key, T& value) {
-        using Serializer = PropertySerializer<typename std::remove_reference<T>::type>;
-        
-        serializers.push_back([key, &value](rapidjson::Value& obj,
-            rapidjson::Document::AllocatorType& alloc) {
-            Serializer::serialize(obj, key, value, alloc);
-        });
+private:
+    static const size_t kLinearScanLimit = 8;
 
-        deserializers.push_back([key, &value](const rapidjson::Value& obj) {
-            Serializer::deserialize(obj, key, value);
-        });
+    std::deque<std::string> keys;
+    std::vector<PropertyDescriptor> properties;
+    PropertyIndex keyIndex;
+};
+
+// 属性类型萃取, 不支持的类型没有定义
+template<typename T, typename Enable = void>
+struct PropertyTraits;
+
+template<PropertyKind Kind>
+struct BasicPropertyTraits {
+    static const PropertyKind kind = Kind;
+    static const PropertyTypeInfo* typeInfo() { return nullptr; }
+};
+
+// 特化 std::string
+template<> struct PropertyTraits<std::string> : BasicPropertyTraits<kStringProperty> {};
+// 特化 int
+template<> struct PropertyTraits<int> : BasicPropertyTraits<kIntProperty> {};
+//特化Unt
+template<> struct PropertyTraits<unsigned int> : BasicPropertyTraits<kUintProperty> {};
+//特化UInt64
+template<> struct PropertyTraits<uint64_t> : BasicPropertyTraits<kUint64Property> {};
+// 特化 double
+template<> struct PropertyTraits<double> : BasicPropertyTraits<kDoubleProperty> {};
+// 特化 bool
+template<> struct PropertyTraits<bool> : BasicPropertyTraits<kBoolProperty> {};
+
+// 添加枚举特化
+template<typename T>
+struct PropertyTraits<T, typename std::enable_if<std::is_enum<T>::value>::type> {
+    static const PropertyKind kind = kEnumProperty;
+
+    static bool serialize(const void* field, rapidjson::Value& out, rapidjson::Document::AllocatorType&) {
+        // 枚举名称由EnumSerializer单例持有, 引用即可
+        const std::string* name = EnumSerializer<T>::nameOf(*static_cast<const T*>(field));
+        if (!name) return false;
+        out.SetString(name->c_str(), static_cast<SizeType>(name->size()));
+        return true;
     }
 
+    static void deserialize(const rapidjson::Value& in, void* field, bool) {
+        T& value = *static_cast<T*>(field);
+        if (in.IsString()) {
+            EnumSerializer<T>::valueOf(std::string(in.GetString(), in.GetStringLength()), value);
+        } else if (in.IsNumber()) {
+            value = static_cast<T>(in.GetInt());
+        }
+    }
 
-    // 注册嵌套对象
-    template<typename T>
-    void registerNestedObject(const std::string& key, T& value) {
-        static_assert(std::is_base_of<JSONSerializable<T>, T>::value,
-            "Nested object must inherit from JSONSerializable");
+    static const std::string* enumName(const void* field) {
+        return EnumSerializer<T>::nameOf(*static_cast<const T*>(field));
+    }
 
-        serializers.push_back([key, &value](rapidjson::Value& obj,
-            rapidjson::Document::AllocatorType& alloc) {
-            rapidjson::Document subDoc;
-            subDoc.Parse(value.toJson().c_str());
-            rapidjson::Value k(key.c_str(), alloc);
-            obj.AddMember(k, subDoc, alloc);
-        });
+    static const PropertyTypeInfo* typeInfo() {
+        static const PropertyTypeInfo info = {
+            &serialize, &deserialize, nullptr, nullptr, nullptr, nullptr, nullptr, &enumName, nullptr
+        };
+        return &info;
+    }
+};
 
-        deserializers.push_back([key, &value](const rapidjson::Value& obj) {
-            if (obj.HasMember(key.c_str()) && obj[key.c_str()].IsObject()) {
-                rapidjson::StringBuffer buffer;
-                rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-                obj[key.c_str()].Accept(writer);
-                value = T::fromJsonStatic(buffer.GetString());
-            }
-        });
+// 借用字符串, T需要提供(data, size)构造函数及data()、size()
+template<typename T>
+struct BorrowedStringTraits {
+    static const PropertyKind kind = kBorrowedStringProperty;
+
+    static void stringData(const void* field, const char*& data, SizeType& length) {
+        const T& value = *static_cast<const T*>(field);
+        data = value.data();
+        length = static_cast<SizeType>(value.size());
     }
-    
-    //注册嵌套对象数组
-    template<typename T>
-    void registerNestedArray(const std::string& key, std::vector<T>& value) {
-        static_assert(std::is_base_of<JSONSerializable<T>, T>::value,
-            "Nested object must inherit from JSONSerializable");
 
-        serializers.push_back([key, &value](rapidjson::Value& obj,
-            rapidjson::Document::AllocatorType& alloc) {
-            rapidjson::Value arr(rapidjson::kArrayType);
-            for (const auto& item : value) {
-                rapidjson::Document subDoc;
-                subDoc.Parse(item.toJson().c_str());
-                arr.PushBack(subDoc, alloc);
-            }
+    // 输出时复制到文档, 文档不依赖被借用的存储
+    static bool serialize(const void* field, rapidjson::Value& out, rapidjson::Document::AllocatorType& alloc) {
+        const T& value = *static_cast<const T*>(field);
+        out.SetString(value.data(), static_cast<SizeType>(value.size()), alloc);
+        return true;
+    }
 
-            rapidjson::Value k(key.c_str(), alloc);
-            obj.AddMember(k, arr, alloc);
-        });
+    static void deserialize(const rapidjson::Value& in, void* field, bool borrow) {
+        if (borrow && in.IsString()) {
+            *static_cast<T*>(field) = T(in.GetString(), in.GetStringLength());
+        }
+    }
+
+    static const PropertyTypeInfo* typeInfo() {
+        static const PropertyTypeInfo info = {
+            &serialize, &deserialize, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, &stringData
+        };
+        return &info;
+    }
+};
+
+template<> struct PropertyTraits<BorrowedString> : BorrowedStringTraits<BorrowedString> {};
+#if __cplusplus >= 201703L
+template<> struct PropertyTraits<std::string_view> : BorrowedStringTraits<std::string_view> {};
+#endif
+
+// 嵌套对象
+template<typename T>
+struct NestedObjectTraits {
+    // 直接写入父文档, 与父文档共用分配器
+    static bool serialize(const void* field, rapidjson::Value& out, rapidjson::Document::AllocatorType& alloc) {
+        out.SetObject();
+        T::schema().serialize(static_cast<const T*>(field), out, alloc);
+        return true;
+    }
+
+    // 原地解码, 缺失的键保持字段不变
+    static void deserialize(const rapidjson::Value& in, void* field, bool borrow) {
+        static_cast<T*>(field)->fromValue(in, borrow);
+    }
+
+    static const ClassSchema& schema() {
+        return T::schema();
+    }
+
+    static const PropertyTypeInfo* typeInfo() {
+        static const PropertyTypeInfo info = {
+            &serialize, &deserialize, &schema, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr
+        };
+        return &info;
+    }
+};
+
+// 嵌套对象数组
+template<typename T>
+struct NestedArrayTraits {
+    static bool serialize(const void* field, rapidjson::Value& out, rapidjson::Document::AllocatorType& alloc) {
+        const std::vector<T>& value = *static_cast<const std::vector<T>*>(field);
+        const ClassSchema& schema = T::schema();
+        out.SetArray();
+        out.Reserve(static_cast<rapidjson::SizeType>(value.size()), alloc);
+        for (const auto& item : value) {
+            rapidjson::Value element(rapidjson::kObjectType);
+            schema.serialize(&item, element, alloc);
+            out.PushBack(element, alloc);
+        }
+        return true;
+    }
 
-        deserializers.push_back([key, &value](const rapidjson::Value& obj) {
-            if (obj.HasMember(key.c_str()) && obj[key.c_str()].IsArray()) {
-                value.clear();
-                for (int i = 0; i < obj[key.c_str()].Size(); i++) {
-                    const rapidjson::Value& item = obj[key.c_str()][i];
-                    if (item.IsObject()) {
-                        rapidjson::StringBuffer buffer;
-                        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-                        item.Accept(writer);
-                        value.push_back(T::fromJsonStatic(buffer.GetString()));
-                    }
+    static void deserialize(const rapidjson::Value& in, void* field, bool borrow) {
+        if (in.IsArray()) {
+            std::vector<T>& value = *static_cast<std::vector<T>*>(field);
+            value.clear();
+            value.reserve(in.Size());
+            for (rapidjson::SizeType i = 0; i < in.Size(); i++) {
+                const rapidjson::Value& item = in[i];
+                if (item.IsObject()) {
+                    value.emplace_back();
+                    value.back().fromValue(item, borrow);
                 }
             }
-        });
+        }
+    }
+
+    static const ClassSchema& schema() {
+        return T::schema();
+    }
+
+    static void clearElements(void* field) {
+        static_cast<std::vector<T>*>(field)->clear();
+    }
+
+    static void* appendElement(void* field) {
+        std::vector<T>& value = *static_cast<std::vector<T>*>(field);
+        value.emplace_back();
+        return &value.back();
+    }
+
+    static size_t elementCount(const void* field) {
+        return static_cast<const std::vector<T>*>(field)->size();
+    }
+
+    static const void* elementAt(const void* field, size_t index) {
+        return &(*static_cast<const std::vector<T>*>(field))[index];
+    }
+
+    static const PropertyTypeInfo* typeInfo() {
+        static const PropertyTypeInfo info = {
+            &serialize, &deserialize, &schema, &clearElements, &appendElement, &elementCount, &elementAt, nullptr, nullptr
+        };
+        return &info;
     }
+};
 
+// 长度受限的原位输入流: 读到buf + length即视为结束, 不要求缓冲区以'\0'结尾
+// 字符串解码后写回源缓冲区, 写入位置始终不超过读取位置
+class BoundedInsituStringStream {
 public:
-    virtual ~JSONSerializable() = default;
+    typedef char Ch;
 
-    // 序列化接口
-    virtual std::string toJson() const {
-        rapidjson::Document doc;
-        doc.SetObject();
-        auto& alloc = doc.GetAllocator();
+    BoundedInsituStringStream(Ch* buf, size_t length) : src(buf), dst(nullptr), head(buf), end(buf + length) {}
+
+    Ch Peek() const { return src != end ? *src : '\0'; }
+    Ch Take() { return src != end ? *src++ : '\0'; }
+    size_t Tell() const { return static_cast<size_t>(src - head); }
+
+    Ch* PutBegin() { return dst = src; }
+    void Put(Ch c) { *dst++ = c; }
+    size_t PutEnd(Ch* begin) { return static_cast<size_t>(dst - begin); }
+    void Flush() {}
 
-        for (const auto& serializer : serializers) {
-            serializer(doc, alloc);
+private:
+    Ch* src;
+    Ch* dst;
+    Ch* head;
+    Ch* end;
+};
+
+#ifndef _WIN32
+// 只读映射整个文件, 析构时解除映射; 按顺序读取提示内核预读, 解析直接读映射区, 不复制到std::string
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) : data(nullptr), size(0), opened(false) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
         }
 
-        rapidjson::StringBuffer buffer;
-        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-        doc.Accept(writer);
-        return buffer.GetString();
+        struct stat info;
+        if (fstat(fd, &info) == 0) {
+            size = static_cast<size_t>(info.st_size);
+            if (size == 0) {
+                opened = true;
+            } else {
+                void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped != MAP_FAILED) {
+                    madvise(mapped, size, MADV_SEQUENTIAL);
+                    data = static_cast<const char*>(mapped);
+                    opened = true;
+                } else {
+                    size = 0;
+                }
+            }
+        }
+        // 映射建立后即可关闭文件描述符
+        close(fd);
     }
 
-    // 反序列化接口
-    virtual bool fromJson(const std::string& jsonStr) {
-        rapidjson::Document doc;
-        doc.Parse(jsonStr.c_str());
+    ~MappedFile() {
+        if (data) {
+            munmap(const_cast<char*>(data), size);
+        }
+    }
 
-        if (doc.HasParseError()) {
-            return false;
+    bool isOpen() const { return opened; }
+    const char* getData() const { return data; }
+    size_t getSize() const { return size; }
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    const char* data;
+    size_t size;
+    bool opened;
+};
+#endif
+
+// SAX解码处理器: 按属性表把解析事件直接写入目标对象, 不构建DOM
+// 未注册的键及类型不符的子树整体跳过; 标量经ClassSchema::deserializeProperty写入, 与DOM路径结果一致
+class SchemaReaderHandler {
+public:
+    typedef char Ch;
+
+    SchemaReaderHandler(const ClassSchema& schema, void* object)
+        : rootSchema(schema), rootObject(object), skipDepth(0) {}
+
+    // 改为解码到另一个对象, 保留帧栈的容量
+    void reset(void* object) {
+        rootObject = object;
+        frames.clear();
+        skipDepth = 0;
+    }
+
+    bool Null() { return scalar(rapidjson::Value()); }
+    bool Bool(bool b) { return scalar(rapidjson::Value(b)); }
+    bool Int(int i) { return scalar(rapidjson::Value(i)); }
+    bool Uint(unsigned u) { return scalar(rapidjson::Value(u)); }
+    bool Int64(int64_t i) { return scalar(rapidjson::Value(i)); }
+    bool Uint64(uint64_t u) { return scalar(rapidjson::Value(u)); }
+    bool Double(double d) { return scalar(rapidjson::Value(d)); }
+    // copy为false(原位解析)时str指向输入缓冲区, 借用字符串可以指向它
+    bool String(const Ch* str, SizeType length, bool copy) { return scalar(rapidjson::Value(str, length), !copy); }
+
+    bool StartObject() {
+        if (skipDepth > 0) {
+            ++skipDepth;
+            return true;
+        }
+        if (frames.empty()) {
+            Frame root = { &rootSchema, rootObject, nullptr, nullptr };
+            frames.push_back(root);
+            return true;
+        }
+
+        Frame& top = frames.back();
+        if (top.arrayInfo) {
+            Frame element = { top.schema, top.arrayInfo->appendElement(top.target), nullptr, nullptr };
+            frames.push_back(element);
+            return true;
         }
 
-        for (const auto& deserializer : deserializers) {
-            deserializer(doc);
+        const PropertyDescriptor* p = top.pending;
+        top.pending = nullptr;
+        if (p && p->kind == kObjectProperty) {
+            Frame nested = { &p->typeInfo->schema(), static_cast<char*>(top.target) + p->offset, nullptr, nullptr };
+            frames.push_back(nested);
+        } else {
+            skipDepth = 1;
         }
         return true;
     }
 
-    // 静态工厂方法
-    static Derived fromJsonStatic(const std::string& jsonStr) {
-        Derived obj;
+    bool Key(const Ch* str, SizeType length, bool) {
+        if (skipDepth == 0) {
+            Frame& top = frames.back();
+            top.pending = top.schema->findProperty(str, length);
+        }
+        return true;
+    }
+
+    bool EndObject(SizeType) {
+        return end();
+    }
+
+    bool StartArray() {
+        if (skipDepth > 0) {
+            ++skipDepth;
+            return true;
+        }
+        // 根节点必须是对象
+        if (frames.empty()) return false;
+
+        Frame& top = frames.back();
+        const PropertyDescriptor* p = top.pending;
+        top.pending = nullptr;
+        if (!top.arrayInfo && p && p->kind == kObjectArrayProperty) {
+            void* field = static_cast<char*>(top.target) + p->offset;
+            p->typeInfo->clearElements(field);
+            Frame array = { &p->typeInfo->schema(), field, p->typeInfo, nullptr };
+            frames.push_back(array);
+        } else {
+            skipDepth = 1;
+        }
+        return true;
+    }
+
+    bool EndArray(SizeType) {
+        return end();
+    }
+
+private:
+    struct Frame {
+        const ClassSchema* schema;          // 对象帧: 对象自身的属性表; 数组帧: 元素的属性表
+        void* target;                       // 对象, 或数组帧中的std::vector字段
+        const PropertyTypeInfo* arrayInfo;  // 非空表示数组帧
+        const PropertyDescriptor* pending;  // 对象帧中最近一个键对应的属性
+    };
+
+    bool scalar(const rapidjson::Value& value, bool borrow = false) {
+        if (skipDepth > 0) return true;
+        // 根节点必须是对象
+        if (frames.empty()) return false;
+
+        // 数组中的非对象元素与DOM路径一样忽略
+        Frame& top = frames.back();
+        if (const PropertyDescriptor* p = top.pending) {
+            top.pending = nullptr;
+            ClassSchema::deserializeProperty(*p, value, top.target, borrow);
+        }
+        return true;
+    }
+
+    bool end() {
+        if (skipDepth > 0) {
+            --skipDepth;
+        } else {
+            frames.pop_back();
+        }
+        return true;
+    }
+
+    const ClassSchema& rootSchema;
+    void* rootObject;
+    std::vector<Frame> frames;
+    unsigned skipDepth;
+};
+
+// 流式数组解码处理器: 根节点必须是数组, 每个对象元素解码到同一个Derived后交给callback, 随即重置
+// 内存中只保留当前元素; 非对象元素与fromJsonArray一样忽略
+template<typename Derived, typename Callback>
+class ArrayStreamHandler {
+public:
+    typedef char Ch;
+
+    ArrayStreamHandler(Callback& callback)
+        : onElement(callback), element(), elementHandler(Derived::schema(), &element),
+          started(false), depth(0), skipDepth(0) {}
+
+    // 元素内的事件交给元素处理器, 根数组层的标量被忽略
+    bool Null() { return depth > 0 ? elementHandler.Null() : topLevelScalar(); }
+    bool Bool(bool b) { return depth > 0 ? elementHandler.Bool(b) : topLevelScalar(); }
+    bool Int(int i) { return depth > 0 ? elementHandler.Int(i) : topLevelScalar(); }
+    bool Uint(unsigned u) { return depth > 0 ? elementHandler.Uint(u) : topLevelScalar(); }
+    bool Int64(int64_t i) { return depth > 0 ? elementHandler.Int64(i) : topLevelScalar(); }
+    bool Uint64(uint64_t u) { return depth > 0 ? elementHandler.Uint64(u) : topLevelScalar(); }
+    bool Double(double d) { return depth > 0 ? elementHandler.Double(d) : topLevelScalar(); }
+    bool String(const Ch* str, SizeType length, bool copy) {
+        return depth > 0 ? elementHandler.String(str, length, copy) : topLevelScalar();
+    }
+
+    bool Key(const Ch* str, SizeType length, bool copy) {
+        return depth > 0 ? elementHandler.Key(str, length, copy) : true;
+    }
+
+    bool StartObject() {
+        if (skipDepth > 0) {
+            ++skipDepth;
+            return true;
+        }
+        if (!started) return false;
+
+        if (depth == 0) {
+            element = Derived();
+            elementHandler.reset(&element);
+        }
+        ++depth;
+        return elementHandler.StartObject();
+    }
+
+    bool EndObject(SizeType memberCount) {
+        if (skipDepth > 0) {
+            --skipDepth;
+            return true;
+        }
+
+        elementHandler.EndObject(memberCount);
+        if (--depth == 0) {
+            onElement(element);
+        }
+        return true;
+    }
+
+    bool StartArray() {
+        if (skipDepth > 0) {
+            ++skipDepth;
+        } else if (!started) {
+            started = true;
+        } else if (depth == 0) {
+            skipDepth = 1;
+        } else {
+            ++depth;
+            return elementHandler.StartArray();
+        }
+        return true;
+    }
+
+    bool EndArray(SizeType elementCount) {
+        if (skipDepth > 0) {
+            --skipDepth;
+        } else if (depth > 0) {
+            --depth;
+            return elementHandler.EndArray(elementCount);
+        }
+        return true;
+    }
+
+private:
+    // 根节点必须是数组
+    bool topLevelScalar() const {
+        return started;
+    }
+
+    Callback& onElement;
+    Derived element;
+    SchemaReaderHandler elementHandler;
+    bool started;       // 已读到根数组的'['
+    unsigned depth;     // 当前元素内的嵌套深度, 0表示位于根数组层
+    unsigned skipDepth; // 根数组中被跳过的非对象元素(嵌套数组)的深度
+};
+
+
+// DOM节点与解析栈都从同一个调用方内存池分配的文档
+typedef rapidjson::GenericDocument<rapidjson::UTF8<>, rapidjson::MemoryPoolAllocator<>, rapidjson::MemoryPoolAllocator<> > PooledDocument;
+
+// PooledDocument解析栈的初始容量, 扩容时旧的栈空间不会归还内存池, 因此取较小的值
+static const size_t kPooledStackCapacity = 256;
+
+// 可复用的序列化上下文: 缓冲区和Writer的层级栈在多次调用间保留已分配的容量,
+// 同一类型反复序列化时稳定后不再分配内存; 不可在多个线程间共享
+// 不带context的toJson使用线程的默认context(threadLocal()), 一次输出超过kMaxRetainedSize时用完即释放缓冲区;
+// 调用方自己创建并传给toJson的context保持用过的最大容量直到release()或销毁
+class SerializationContext {
+public:
+    // 默认context在两次调用之间最多保留的缓冲区字节数
+    static const size_t kMaxRetainedSize = 1024 * 1024;
+
+    SerializationContext() : writer(buffer), inUse(false) {}
+    SerializationContext(const SerializationContext&) = delete;
+    SerializationContext& operator=(const SerializationContext&) = delete;
+
+    // 清空内部缓冲区, 返回输出到该缓冲区的writer
+    rapidjson::Writer<rapidjson::StringBuffer>& reset() {
+        return reset(buffer);
+    }
+
+    // 清空out, 返回输出到out的writer
+    rapidjson::Writer<rapidjson::StringBuffer>& reset(rapidjson::StringBuffer& out) {
+        out.Clear();
+        writer.Reset(out);
+        return writer;
+    }
+
+    const rapidjson::StringBuffer& getBuffer() const { return buffer; }
+
+    // 释放内部缓冲区; Writer的层级栈只与嵌套深度有关, 保留
+    void release() {
+        buffer.Clear();
+        buffer.ShrinkToFit();
+    }
+
+    // 当前线程的默认context, 线程结束时销毁
+    static SerializationContext& threadLocal() {
+        static thread_local SerializationContext context;
+        return context;
+    }
+
+private:
+    friend class ThreadSerializationContext;
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer;
+    bool inUse;                                     // 默认context正被本线程外层的toJson使用
+};
+
+// 在作用域内占用线程的默认context, 离开时缓冲区超过kMaxRetainedSize则释放
+// 属性的序列化函数里再调用toJson时默认context已被外层占用, 改用一个临时context
+class ThreadSerializationContext {
+public:
+    ThreadSerializationContext()
+        : shared(SerializationContext::threadLocal()), nested(shared.inUse) {
+        shared.inUse = true;
+    }
+
+    ~ThreadSerializationContext() {
+        if (nested) return;
+        shared.inUse = false;
+        if (shared.buffer.GetSize() > SerializationContext::kMaxRetainedSize) {
+            shared.release();
+        }
+    }
+
+    ThreadSerializationContext(const ThreadSerializationContext&) = delete;
+    ThreadSerializationContext& operator=(const ThreadSerializationContext&) = delete;
+
+    SerializationContext& get() { return nested ? local : shared; }
+
+private:
+    SerializationContext& shared;
+    const bool nested;
+    SerializationContext local;
+};
+
+// 分块输出的默认块大小
+static const size_t kSinkChunkSize = 4096;
+
+// 输出目标(Sink)的write(const char* data, size_t size)返回值
+enum SinkStatus {
+    kSinkOk,        // 已接收整块数据
+    kSinkRetry,     // 暂时无法接收, 稍后以同一块数据重试
+    kSinkError      // 放弃输出, 后续数据被丢弃
+};
+
+// 写入std::ostream的输出目标, 阻塞直到写完
+class OStreamSink {
+public:
+    explicit OStreamSink(std::ostream& os) : os(os) {}
+
+    SinkStatus write(const char* data, size_t size) {
+        os.write(data, static_cast<std::streamsize>(size));
+        return os ? kSinkOk : kSinkError;
+    }
+
+private:
+    std::ostream& os;
+};
+
+// 把每块数据交给回调SinkStatus(const char*, size_t)的输出目标
+template<typename Callback>
+class CallbackSink {
+public:
+    explicit CallbackSink(Callback callback) : callback(callback) {}
+
+    SinkStatus write(const char* data, size_t size) {
+        return callback(data, size);
+    }
+
+private:
+    Callback callback;
+};
+
+template<typename Callback>
+CallbackSink<Callback> makeCallbackSink(Callback callback) {
+    return CallbackSink<Callback>(callback);
+}
+
+// 固定大小缓冲区的rapidjson输出流: 缓冲区写满或Flush时把整块交给sink, 内存占用只有一块
+// sink返回kSinkRetry时让出线程后重试同一块, 由此向writer施加反压
+template<typename Sink>
+class ChunkedWriteStream {
+public:
+    typedef char Ch;
+
+    ChunkedWriteStream(Sink& sink, Ch* buffer, size_t size)
+        : sink(sink), buffer(buffer), current(buffer), end(buffer + size), failed(false) {}
+
+    void Put(Ch c) {
+        if (current == end) {
+            emit();
+        }
+        *current++ = c;
+    }
+
+    void Flush() { emit(); }
+
+    // sink是否接收了已输出的全部数据
+    bool good() const { return !failed; }
+
+    // 以下接口不支持
+    Ch Peek() const { RAPIDJSON_ASSERT(false); return 0; }
+    Ch Take() { RAPIDJSON_ASSERT(false); return 0; }
+    size_t Tell() const { RAPIDJSON_ASSERT(false); return 0; }
+    Ch* PutBegin() { RAPIDJSON_ASSERT(false); return 0; }
+    size_t PutEnd(Ch*) { RAPIDJSON_ASSERT(false); return 0; }
+
+private:
+    RAPID_JSON_WRAPPER_NOINLINE void emit() {
+        const size_t size = static_cast<size_t>(current - buffer);
+        current = buffer;
+        if (size == 0 || failed) return;
+
+        SinkStatus status;
+        while ((status = sink.write(buffer, size)) == kSinkRetry) {
+            std::this_thread::yield();
+        }
+        failed = status != kSinkOk;
+    }
+
+    Sink& sink;
+    Ch* buffer;
+    Ch* current;
+    Ch* end;
+    bool failed;
+};
+
+// 写入调用方固定缓冲区的输出流: 超出容量的字符不再写入而只计数, 以便得到所需的大小
+class FixedBufferStream {
+public:
+    typedef char Ch;
+
+    FixedBufferStream(Ch* buffer, size_t capacity) : buffer(buffer), capacity(capacity), size(0) {}
+
+    void Put(Ch c) {
+        if (size < capacity) {
+            buffer[size] = c;
+        }
+        ++size;
+    }
+
+    void Flush() {}
+
+    // 已输出的字节数, 大于容量时为完整输出所需的大小
+    size_t getSize() const { return size; }
+    bool overflowed() const { return size > capacity; }
+
+private:
+    Ch* buffer;
+    size_t capacity;
+    size_t size;
+};
+
+// 固定缓冲区序列化时Writer层级栈所用的栈上内存, 可容纳约48层嵌套
+static const size_t kFixedWriterStackSize = 1024;
+
+// 分段输出缓冲区的默认块大小
+static const size_t kSegmentBlockSize = 64 * 1024;
+
+// 固定大小内存块的池: 缓冲区clear或析构时把块归还到池中, 供之后的输出复用; 不可在多个线程间共享
+class BlockPool {
+public:
+    explicit BlockPool(size_t blockSize = kSegmentBlockSize) : blockSize(std::max<size_t>(blockSize, 1)) {}
+    BlockPool(const BlockPool&) = delete;
+    BlockPool& operator=(const BlockPool&) = delete;
+
+    ~BlockPool() {
+        for (char* block : freeBlocks) {
+            delete[] block;
+        }
+    }
+
+    char* acquire() {
+        if (freeBlocks.empty()) {
+            return new char[blockSize];
+        }
+        char* block = freeBlocks.back();
+        freeBlocks.pop_back();
+        return block;
+    }
+
+    void release(char* block) { freeBlocks.push_back(block); }
+
+    size_t getBlockSize() const { return blockSize; }
+    size_t getFreeCount() const { return freeBlocks.size(); }
+
+private:
+    size_t blockSize;
+    std::vector<char*> freeBlocks;
+};
+
+// 分段输出缓冲区: 由池中的固定大小块组成, 写满一块后取下一块, 已写入的内容不会像StringBuffer扩容那样被复制
+// 可作为Writer的输出流; 各段可直接交给writev, 无需拼接成连续内存
+class SegmentedBuffer {
+public:
+    typedef char Ch;
+
+    // 使用自有的池, clear后保留已取得的块
+    explicit SegmentedBuffer(size_t blockSize = kSegmentBlockSize)
+        : ownPool(new BlockPool(blockSize)), pool(*ownPool),
+          current(nullptr), end(nullptr), segmentBegin(nullptr), closedSize(0) {}
+
+    // 从共享的池取块, 析构时归还; pool须比缓冲区存活得更久
+    explicit SegmentedBuffer(BlockPool& pool)
+        : pool(pool), current(nullptr), end(nullptr), segmentBegin(nullptr), closedSize(0) {}
+
+    SegmentedBuffer(const SegmentedBuffer&) = delete;
+    SegmentedBuffer& operator=(const SegmentedBuffer&) = delete;
+
+    ~SegmentedBuffer() { clear(); }
+
+    void Put(Ch c) {
+        if (current == end) {
+            nextBlock();
+        }
+        *current++ = c;
+    }
+
+    void Flush() {}
+
+    // 追加一段字节, 跨块时分开复制
+    void append(const Ch* data, size_t size) {
+        while (size > 0) {
+            if (current == end) {
+                nextBlock();
+            }
+            const size_t count = std::min(size, static_cast<size_t>(end - current));
+            memcpy(current, data, count);
+            current += count;
+            data += count;
+            size -= count;
+        }
+    }
+
+    // 追加对外部内存的引用而不复制, 之后的写入在当前块中继续; 该内存须在输出被使用完之前保持有效且不被修改
+    void appendReference(const Ch* data, size_t size) {
+        if (size == 0) return;
+
+        closeSegment();
+        Segment segment = { data, size };
+        segments.push_back(segment);
+        closedSize += size;
+    }
+
+    // 清空内容并把块归还到池中
+    void clear() {
+        for (char* block : blocks) {
+            pool.release(block);
+        }
+        blocks.clear();
+        segments.clear();
+        current = end = segmentBegin = nullptr;
+        closedSize = 0;
+    }
+
+    size_t getSize() const { return closedSize + static_cast<size_t>(current - segmentBegin); }
+
+    // 按顺序对每个非空段调用f(const char* data, size_t size)
+    template<typename Function>
+    void forEachSegment(Function f) const {
+        for (const Segment& segment : segments) {
+            f(segment.data, segment.size);
+        }
+        if (current != segmentBegin) {
+            f(static_cast<const char*>(segmentBegin), static_cast<size_t>(current - segmentBegin));
+        }
+    }
+
+    // 复制为连续的字符串
+    void copyTo(std::string& out) const {
+        out.clear();
+        out.reserve(getSize());
+        forEachSegment([&out](const char* data, size_t size) { out.append(data, size); });
+    }
+
+#ifndef _WIN32
+    // 以iovec列表给出各段, 在下一次写入或clear之前有效; 段数超过IOV_MAX时需分批调用writev
+    void getIovecs(std::vector<iovec>& out) const {
+        out.clear();
+        forEachSegment([&out](const char* data, size_t size) {
+            iovec segment;
+            segment.iov_base = const_cast<char*>(data);
+            segment.iov_len = size;
+            out.push_back(segment);
+        });
+    }
+#endif
+
+private:
+    struct Segment {
+        const char* data;
+        size_t size;
+    };
+
+    RAPID_JSON_WRAPPER_NOINLINE void nextBlock() {
+        closeSegment();
+        char* block = pool.acquire();
+        blocks.push_back(block);
+        current = segmentBegin = block;
+        end = block + pool.getBlockSize();
+    }
+
+    // 把当前块中已写入的部分记为一段
+    void closeSegment() {
+        if (current != segmentBegin) {
+            Segment segment = { segmentBegin, static_cast<size_t>(current - segmentBegin) };
+            segments.push_back(segment);
+            closedSize += segment.size;
+        }
+        segmentBegin = current;
+    }
+
+    std::unique_ptr<BlockPool> ownPool;
+    BlockPool& pool;
+    std::vector<char*> blocks;
+    std::vector<Segment> segments;      // 已结束的段(块中的片段或外部引用), 不含当前块中正在写入的部分
+    Ch* current;
+    Ch* end;
+    Ch* segmentBegin;
+    size_t closedSize;                  // segments的总字节数
+};
+
+// 分散输出时被引用而不复制的字符串片段的默认最小长度
+static const size_t kScatterReferenceSize = 1024;
+
+// 多线程批量序列化时每个线程至少分到的元素个数, 元素更少时启动线程的开销超过并行的收益
+static const size_t kParallelChunkItems = 256;
+
+// 析构时join尚未结束的线程: 异常离开作用域时std::thread仍是joinable会调用std::terminate
+class JoiningThreads {
+public:
+    JoiningThreads() {}
+    JoiningThreads(const JoiningThreads&) = delete;
+    JoiningThreads& operator=(const JoiningThreads&) = delete;
+    ~JoiningThreads() { join(); }
+
+    void reserve(size_t count) { threads.reserve(count); }
+
+    // 启动线程执行function; 线程创建失败时抛出std::system_error, 已启动的线程仍由析构函数join
+    template<typename Function>
+    void start(Function&& function) { threads.emplace_back(std::forward<Function>(function)); }
+
+    void join() {
+        for (auto& thread : threads) {
+            if (thread.joinable()) thread.join();
+        }
+        threads.clear();
+    }
+
+private:
+    std::vector<std::thread> threads;
+};
+
+// 分散输出的Writer: 字符串中长度达到referenceSize且无需转义的片段以引用的形式加入SegmentedBuffer,
+// 其余内容(结构符号、键、数字、短字符串及转义序列)照常写入缓冲区的块中; 输出与Writer逐字节相同
+class ScatterWriter : public rapidjson::Writer<SegmentedBuffer> {
+public:
+    ScatterWriter(SegmentedBuffer& out, size_t referenceSize = kScatterReferenceSize)
+        : rapidjson::Writer<SegmentedBuffer>(out), referenceSize(std::max<size_t>(referenceSize, 1)) {}
+
+    bool String(const Ch* str, SizeType length, bool copy = false) {
+        if (length < referenceSize) {
+            return rapidjson::Writer<SegmentedBuffer>::String(str, length, copy);
+        }
+
+        Prefix(rapidjson::kStringType);
+        os_->Put('"');
+        const Ch* run = str;
+        const Ch* end = str + length;
+        for (const Ch* p = findJsonEscape(str, end); p != end; p = findJsonEscape(p + 1, end)) {
+            writeRun(run, p);
+            writeEscape(static_cast<unsigned char>(*p));
+            run = p + 1;
+        }
+        writeRun(run, end);
+        os_->Put('"');
+        return true;
+    }
+
+    bool String(const std::string& str) {
+        return String(str.data(), static_cast<SizeType>(str.size()));
+    }
+
+    bool String(const Ch* str) {
+        return String(str, static_cast<SizeType>(strlen(str)));
+    }
+
+private:
+    void writeRun(const Ch* begin, const Ch* end) {
+        const size_t size = static_cast<size_t>(end - begin);
+        if (size >= referenceSize) {
+            os_->appendReference(begin, size);
+        } else {
+            os_->append(begin, size);
+        }
+    }
+
+    // 与Writer::WriteString相同的转义规则
+    void writeEscape(unsigned char c) {
+        static const char hexDigits[16] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F' };
+        os_->Put('\\');
+        switch (c) {
+            case '"': os_->Put('"'); break;
+            case '\\': os_->Put('\\'); break;
+            case '\b': os_->Put('b'); break;
+            case '\t': os_->Put('t'); break;
+            case '\n': os_->Put('n'); break;
+            case '\f': os_->Put('f'); break;
+            case '\r': os_->Put('r'); break;
+            default:
+                os_->Put('u');
+                os_->Put('0');
+                os_->Put('0');
+                os_->Put(hexDigits[c >> 4]);
+                os_->Put(hexDigits[c & 0xF]);
+                break;
+        }
+    }
+
+    size_t referenceSize;
+};
+
+// 基础序列化类
+// 属性在派生类构造函数中注册, 但只有构建属性表的原型对象会真正记录,
+// 普通实例不携带任何元数据; 注册必须在每个构造函数中无条件地以相同顺序进行,
+// 且只能注册对象自身的数据成员, 不能注册引用成员、静态变量或指针指向的存储
+// 属性表只按Derived构建, 因此Derived的子类(如Admin : User)不能再注册自己的成员, 否则构造时抛出std::logic_error;
+// 这样的子类按Derived的属性表序列化, 需要额外字段时改用组合
+template<typename Derived>
+class JSONSerializable {
+protected:
+    // 添加注册枚举的便捷方法
+    template<typename EnumType>
+    void registerEnum(const char* key, EnumType& value) {
+        static_assert(std::is_enum<EnumType>::value, "Type must be an enum");
+        registerProperty(key, value);
+    }
+
+    template<typename EnumType>
+    void registerEnum(const std::string& key, EnumType& value) {
+        registerEnum(key.c_str(), value);
+    }
+
+    // 在 JSONSerializable 类中使用
+    template<typename T>
+    void registerProperty(const char* key, T& value) {
+        using Traits = PropertyTraits<typename std::remove_reference<T>::type>;
+        addProperty(key, value, Traits::kind, Traits::typeInfo());
+    }
+
+    template<typename T>
+    void registerProperty(const std::string& key, T& value) {
+        registerProperty(key.c_str(), value);
+    }
+
+    // 注册嵌套对象
+    template<typename T>
+    void registerNestedObject(const char* key, T& value) {
+        static_assert(std::is_base_of<JSONSerializable<T>, T>::value,
+            "Nested object must inherit from JSONSerializable");
+        addProperty(key, value, kObjectProperty, NestedObjectTraits<T>::typeInfo());
+    }
+
+    template<typename T>
+    void registerNestedObject(const std::string& key, T& value) {
+        registerNestedObject(key.c_str(), value);
+    }
+
+    //注册嵌套对象数组
+    template<typename T>
+    void registerNestedArray(const char* key, std::vector<T>& value) {
+        static_assert(std::is_base_of<JSONSerializable<T>, T>::value,
+            "Nested object must inherit from JSONSerializable");
+        addProperty(key, value, kObjectArrayProperty, NestedArrayTraits<T>::typeInfo());
+    }
+
+    template<typename T>
+    void registerNestedArray(const std::string& key, std::vector<T>& value) {
+        registerNestedArray(key.c_str(), value);
+    }
+
+private:
+    // 在chunkCount个线程上执行task(chunk), 第0块在调用线程上执行
+    // 全部线程结束后重新抛出第一个task抛出的异常; 线程创建失败时等已启动的线程结束后抛出std::system_error
+    template<typename Task>
+    static void runChunks(size_t chunkCount, const Task& task) {
+        std::mutex mutex;
+        std::exception_ptr failure;
+        auto run = [&](size_t chunk) {
+            try {
+                task(chunk);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!failure) failure = std::current_exception();
+            }
+        };
+
+        {
+            JoiningThreads workers;
+            workers.reserve(chunkCount - 1);
+            for (size_t chunk = 1; chunk < chunkCount; chunk++) {
+                workers.start([&run, chunk] { run(chunk); });
+            }
+            run(0);
+        }
+        if (failure) std::rethrow_exception(failure);
+    }
+
+    bool fromJsonPooled(const std::string& jsonStr, rapidjson::MemoryPoolAllocator<>& allocator, bool borrowStrings) {
+        PooledDocument doc(&allocator, kPooledStackCapacity, &allocator);
+        doc.Parse(jsonStr.c_str());
+
+        if (doc.HasParseError()) {
+            return false;
+        }
+
+        return fromValue(doc, borrowStrings);
+    }
+
+    // 正在构建的属性表, 仅在构造原型对象期间非空
+    static ClassSchema*& schemaBuilder() {
+        static thread_local ClassSchema* builder = nullptr;
+        return builder;
+    }
+
+    // 属性表只记录成员相对对象起始地址的偏移, 因此value必须是本对象的数据成员(可以是基类或嵌套结构中的成员)
+    // 引用成员所指的对象、静态变量或指针指向的存储不在对象内, 断言失败; 未启用断言时忽略该属性
+    // 从Derived的子类构造函数中注册时动态类型不是Derived, 其成员不在属性表中, 每个实例都抛出异常而不是丢弃这些成员
+    template<typename T>
+    void addProperty(const char* key, const T& value, PropertyKind kind, const PropertyTypeInfo* typeInfo) {
+        if (typeid(*this) != typeid(Derived)) {
+            throw std::logic_error(std::string("Classes derived from a serializable type cannot register members: ") + key);
+        }
+
+        ClassSchema* schema = schemaBuilder();
+        if (!schema) return;
+
+        const uintptr_t base = reinterpret_cast<uintptr_t>(static_cast<const Derived*>(this));
+        const uintptr_t member = reinterpret_cast<uintptr_t>(&value);
+        const bool inside = member >= base && sizeof(T) <= sizeof(Derived) && member - base <= sizeof(Derived) - sizeof(T);
+        RAPIDJSON_ASSERT(inside && "Only data members of the object itself can be registered");
+        if (!inside) return;
+
+        schema->addProperty(key, static_cast<size_t>(member - base), kind, typeInfo);
+    }
+
+    // 构造一个原型对象, 由其构造函数中的注册调用填充属性表
+    static bool buildSchema(ClassSchema& schema) {
+        struct BuilderScope {
+            explicit BuilderScope(ClassSchema* schema) { schemaBuilder() = schema; }
+            ~BuilderScope() { schemaBuilder() = nullptr; }
+        } scope(&schema);
+
+        {
+            Derived prototype;
+            (void)prototype;
+        }
+        schema.buildIndex();
+        return true;
+    }
+
+public:
+    virtual ~JSONSerializable() = default;
+
+    // 类型共享的属性表, 首次调用时线程安全地构建
+    static const ClassSchema& schema() {
+        static ClassSchema instance;
+        static const bool built = buildSchema(instance);
+        (void)built;
+        return instance;
+    }
+
+    // 序列化接口
+    virtual std::string toJson() const {
+        ThreadSerializationContext context;
+        toJsonWriter(context.get().reset());
+        const rapidjson::StringBuffer& buffer = context.get().getBuffer();
+        return std::string(buffer.GetString(), buffer.GetSize());
+    }
+
+    // 序列化到out, 复用out已有的容量, 经线程的默认context输出
+    void toJson(std::string& out) const {
+        ThreadSerializationContext context;
+        toJson(out, context.get());
+    }
+
+    // 序列化到out, out原有内容被清空; Writer的层级栈由线程的默认context提供
+    void toJson(rapidjson::StringBuffer& out) const {
+        ThreadSerializationContext context;
+        toJson(out, context.get());
+    }
+
+    // 经context序列化到out, 复用out与context已有的容量
+    void toJson(std::string& out, SerializationContext& context) const {
+        toJsonWriter(context.reset());
+        const rapidjson::StringBuffer& buffer = context.getBuffer();
+        out.assign(buffer.GetString(), buffer.GetSize());
+    }
+
+    // 序列化到out, out原有内容被清空; Writer的层级栈由context提供
+    void toJson(rapidjson::StringBuffer& out, SerializationContext& context) const {
+        toJsonWriter(context.reset(out));
+    }
+
+    // 序列化到调用方的固定缓冲区, 不写入结尾的'\0'; Writer的层级栈位于栈上, 不构建Document,
+    // 嵌套不超过约48层时不分配堆内存
+    // 返回输出的字节数; 返回值大于capacity表示缓冲区不足, 此时为所需的大小, buffer中只有前capacity个字节
+    size_t toJson(char* buffer, size_t capacity) const {
+        uint64_t levelBuffer[kFixedWriterStackSize / sizeof(uint64_t)];
+        rapidjson::MemoryPoolAllocator<> levelAllocator(levelBuffer, sizeof(levelBuffer));
+        FixedBufferStream stream(buffer, capacity);
+        rapidjson::Writer<FixedBufferStream, rapidjson::UTF8<>, rapidjson::UTF8<>, rapidjson::MemoryPoolAllocator<> >
+            writer(stream, &levelAllocator);
+        toJsonWriter(writer);
+        return stream.getSize();
+    }
+
+    // 序列化到分段缓冲区, out原有内容被清空
+    void toJson(SegmentedBuffer& out) const {
+        out.clear();
+        toJsonStream(out);
+    }
+
+    // 分散输出到out: 长字符串字段直接被引用, 不复制到缓冲区; out.getIovecs()可交给writev/sendmsg
+    // 在out被使用完之前, 本对象的字符串字段不能被修改或销毁
+    void toJsonScatter(SegmentedBuffer& out, size_t referenceSize = kScatterReferenceSize) const {
+        out.clear();
+        ScatterWriter writer(out, referenceSize);
+        toJsonWriter(writer);
+    }
+
+    // 分块输出到sink, 不在内存中保留完整结果; sink需提供返回SinkStatus的write(const char*, size_t)
+    // 返回false表示sink返回了kSinkError, 此后的输出被丢弃
+    template<typename Sink, typename std::enable_if<std::is_convertible<
+        decltype(std::declval<Sink&>().write(static_cast<const char*>(nullptr), size_t())), SinkStatus>::value, int>::type = 0>
+    bool toJson(Sink& sink, size_t chunkSize = kSinkChunkSize) const {
+        std::vector<char> chunk(std::max<size_t>(chunkSize, 1));
+        ChunkedWriteStream<Sink> stream(sink, chunk.data(), chunk.size());
+        toJsonStream(stream);
+        stream.Flush();
+        return stream.good();
+    }
+
+    // 分块写入std::ostream, 流进入错误状态时返回false
+    bool toJson(std::ostream& os, size_t chunkSize = kSinkChunkSize) const {
+        OStreamSink sink(os);
+        return toJson(sink, chunkSize);
+    }
+
+    // 直接输出到任意rapidjson输出流, 不构建Document
+    template<typename OutputStream>
+    void toJsonStream(OutputStream& stream) const {
+        rapidjson::Writer<OutputStream> writer(stream);
+        toJsonWriter(writer);
+    }
+
+    // 输出到调用方提供的Writer(如PrettyWriter)
+    template<typename Writer>
+    void toJsonWriter(Writer& writer) const {
+        writer.StartObject();
+        schema().write(static_cast<const Derived*>(this), writer);
+        writer.EndObject();
+    }
+
+    // toJson()输出的精确字节数, 只遍历属性表计算长度, 不产生输出; 可据此一次分配好带长度前缀的帧
+    size_t serializedSize() const {
+        return schema().serializedSize(static_cast<const Derived*>(this));
+    }
+
+    // 序列化到DOM节点, value被置为对象并使用alloc分配
+    void toValue(rapidjson::Value& value, rapidjson::Document::AllocatorType& alloc) const {
+        value.SetObject();
+        schema().serialize(static_cast<const Derived*>(this), value, alloc);
+    }
+
+    // 反序列化接口
+    virtual bool fromJson(const std::string& jsonStr) {
+        rapidjson::Document doc;
+        doc.Parse(jsonStr.c_str());
+
+        if (doc.HasParseError()) {
+            return false;
+        }
+
+        return fromValue(doc, false);
+    }
+
+    // 按长度解析, 不要求以'\0'结尾, 可直接传入从socket或mmap得到的字节
+    bool fromJson(const char* data, size_t length) {
+        rapidjson::Document doc;
+        rapidjson::MemoryStream stream(data, length);
+        doc.ParseStream<rapidjson::kParseDefaultFlags, rapidjson::UTF8<> >(stream);
+
+        if (doc.HasParseError()) {
+            return false;
+        }
+
+        return fromValue(doc, false);
+    }
+
+#ifndef _WIN32
+    // 映射文件后直接解析, 不先读入std::string; 文件无法打开或解析失败时返回false
+    bool fromJsonFile(const std::string& path) {
+        MappedFile file(path);
+        return file.isOpen() && fromJson(file.getData(), file.getSize());
+    }
+#endif
+
+#if __cplusplus >= 201703L
+    // 只匹配std::string_view本身, 字符串字面量仍选择const std::string&重载而不产生歧义
+    template<typename View, typename std::enable_if<std::is_same<View, std::string_view>::value, int>::type = 0>
+    bool fromJson(View jsonStr) {
+        return fromJson(jsonStr.data(), jsonStr.size());
+    }
+#endif
+
+    // 使用调用方的内存池解析, DOM节点与解析栈都从allocator分配; 字段解码完成后即可Clear该内存池
+    // 借用字符串指向该内存池, 在其Clear之前有效
+    bool fromJson(const std::string& jsonStr, rapidjson::MemoryPoolAllocator<>& allocator) {
+        return fromJsonPooled(jsonStr, allocator, true);
+    }
+
+    // 使用调用方的缓冲区(如栈上数组)解析, 缓冲区用尽时才向系统申请新块
+    // 新块在返回前释放, 因此不填充借用字符串
+    bool fromJson(const std::string& jsonStr, void* buffer, size_t size) {
+        rapidjson::MemoryPoolAllocator<> allocator(buffer, size);
+        return fromJsonPooled(jsonStr, allocator, false);
+    }
+
+    // 原位解析: 字符串直接在buf中解码, 不复制到内存池; buf的内容会被改写
+    // 没有借用字符串字段时解码完成后即可丢弃buf, 否则借用字符串指向buf
+    bool fromJsonInsitu(char* buf, size_t len) {
+        rapidjson::Document doc;
+        BoundedInsituStringStream stream(buf, len);
+        doc.ParseStream<rapidjson::kParseInsituFlag>(stream);
+
+        if (doc.HasParseError()) {
+            return false;
+        }
+
+        return fromValue(doc);
+    }
+
+    // SAX反序列化接口: 不构建DOM, 解析事件直接写入字段
+    // 与fromJson结果一致; 但解析出错时, 出错位置之前的字段已被更新
+    virtual bool fromJsonSax(const std::string& jsonStr) {
+        rapidjson::StringStream stream(jsonStr.c_str());
+        return fromJsonStream(stream);
+    }
+
+    // 从任意rapidjson输入流进行SAX反序列化; 使用kParseInsituFlag时借用字符串指向流的缓冲区
+    template<unsigned parseFlags = rapidjson::kParseDefaultFlags, typename InputStream>
+    bool fromJsonStream(InputStream& stream) {
+        rapidjson::SchemaReaderHandler handler(schema(), static_cast<Derived*>(this));
+        rapidjson::Reader reader;
+        return !reader.Parse<parseFlags>(stream, handler).IsError();
+    }
+
+    // 从已解析的节点反序列化, 嵌套对象直接在父文档上解码
+    // borrowStrings为true时借用字符串指向value的存储, 调用方需保留value所在的文档
+    bool fromValue(const rapidjson::Value& value, bool borrowStrings = true) {
+        if (!value.IsObject()) {
+            return false;
+        }
+
+        schema().deserialize(value, static_cast<Derived*>(this), borrowStrings);
+        return true;
+    }
+
+    // 流式解码根节点为数组的输入: 每解码出一个对象元素即调用callback(Derived&), 内存占用取决于单个元素的大小
+    // 使用迭代解析, 不因嵌套深度占用调用栈; 解析出错或根节点不是数组时返回false, 出错前的元素已交付
+    template<unsigned parseFlags = rapidjson::kParseDefaultFlags, typename InputStream, typename Callback>
+    static bool fromJsonArrayStream(InputStream& stream, Callback callback) {
+        rapidjson::ArrayStreamHandler<Derived, Callback> handler(callback);
+        rapidjson::Reader reader;
+        return !reader.Parse<parseFlags | rapidjson::kParseIterativeFlag>(stream, handler).IsError();
+    }
+
+    // 按块读取文件流式解码, 不把整个文件读入内存
+    template<typename Callback>
+    static bool fromJsonArrayFile(std::FILE* fp, Callback callback) {
+        char buffer[64 * 1024];
+        rapidjson::FileReadStream stream(fp, buffer, sizeof(buffer));
+        return fromJsonArrayStream(stream, callback);
+    }
+
+    // 静态工厂方法
+    static Derived fromJsonStatic(const std::string& jsonStr) {
+        Derived obj;
         obj.fromJson(jsonStr);
         return obj;
     }
+
+    // 批量接口: 整个集合对应一个JSON数组, 所有元素共用一个writer或一个文档
+    static std::string toJsonArray(const std::vector<Derived>& items) {
+        ThreadSerializationContext context;
+        toJsonArrayWriter(items, context.get().reset());
+        const rapidjson::StringBuffer& buffer = context.get().getBuffer();
+        return std::string(buffer.GetString(), buffer.GetSize());
+    }
+
+    static void toJsonArray(const std::vector<Derived>& items, std::string& out) {
+        ThreadSerializationContext context;
+        toJsonArray(items, out, context.get());
+    }
+
+    static void toJsonArray(const std::vector<Derived>& items, rapidjson::StringBuffer& out) {
+        ThreadSerializationContext context;
+        toJsonArray(items, out, context.get());
+    }
+
+    static void toJsonArray(const std::vector<Derived>& items, std::string& out, SerializationContext& context) {
+        toJsonArrayWriter(items, context.reset());
+        const rapidjson::StringBuffer& buffer = context.getBuffer();
+        out.assign(buffer.GetString(), buffer.GetSize());
+    }
+
+    static void toJsonArray(const std::vector<Derived>& items, rapidjson::StringBuffer& out, SerializationContext& context) {
+        toJsonArrayWriter(items, context.reset(out));
+    }
+
+    // 序列化到分段缓冲区, out原有内容被清空; 输出很大时避免StringBuffer扩容的复制与双倍内存
+    static void toJsonArray(const std::vector<Derived>& items, SegmentedBuffer& out) {
+        out.clear();
+        rapidjson::Writer<SegmentedBuffer> writer(out);
+        toJsonArrayWriter(items, writer);
+    }
+
+    // toJsonArray(items)输出的精确字节数
+    static size_t serializedArraySize(const std::vector<Derived>& items) {
+        size_t size = items.empty() ? 2 : items.size() + 1;
+        for (const Derived& item : items) {
+            size += item.serializedSize();
+        }
+        return size;
+    }
+
+    // 分散输出到out, 规则同toJsonScatter; 在out被使用完之前items不能被修改或销毁
+    static void toJsonArrayScatter(const std::vector<Derived>& items, SegmentedBuffer& out,
+                                   size_t referenceSize = kScatterReferenceSize) {
+        out.clear();
+        ScatterWriter writer(out, referenceSize);
+        toJsonArrayWriter(items, writer);
+    }
+
+    template<typename Writer>
+    static void toJsonArrayWriter(const std::vector<Derived>& items, Writer& writer) {
+        const ClassSchema& properties = schema();
+        writer.StartArray();
+        for (const auto& item : items) {
+            writer.StartObject();
+            properties.write(&item, writer);
+            writer.EndObject();
+        }
+        writer.EndArray();
+    }
+
+    // 多线程批量序列化, 输出与toJsonArray逐字节一致; threadCount为0时使用硬件线程数
+    // 集合按线程数分块, 每块至少kParallelChunkItems个元素, 不足两块时在调用线程上顺序输出;
+    // 各块在工作线程中输出到自己的缓冲区; 再按各块大小的前缀和算出偏移, 第二轮并行把各块复制到一次分配好大小的out中
+    static void toJsonArrayParallel(const std::vector<Derived>& items, std::string& out, unsigned threadCount = 0) {
+        if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+        const size_t chunkCount = std::min<size_t>(threadCount, items.size() / kParallelChunkItems);
+        if (chunkCount <= 1) {
+            toJsonArray(items, out);
+            return;
+        }
+
+        // 各块并行输出, 块内元素以逗号分隔
+        std::unique_ptr<rapidjson::StringBuffer[]> chunks(new rapidjson::StringBuffer[chunkCount]);
+        runChunks(chunkCount, [&](size_t chunk) {
+            const ClassSchema& properties = schema();
+            rapidjson::StringBuffer& buffer = chunks[chunk];
+            rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+            const size_t begin = items.size() * chunk / chunkCount;
+            const size_t end = items.size() * (chunk + 1) / chunkCount;
+            for (size_t i = begin; i < end; i++) {
+                if (i != begin) buffer.Put(',');
+                writer.Reset(buffer);
+                writer.StartObject();
+                properties.write(&items[i], writer);
+                writer.EndObject();
+            }
+        });
+
+        // 前缀和: 块chunk之前是'['与前面各块, 各块之间以逗号分隔
+        std::vector<size_t> offsets(chunkCount + 1);
+        offsets[0] = 1;
+        for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+            offsets[chunk + 1] = offsets[chunk] + chunks[chunk].GetSize() + 1;
+        }
+        out.resize(offsets[chunkCount]);
+        char* target = &out[0];
+        target[0] = '[';
+        runChunks(chunkCount, [&](size_t chunk) {
+            memcpy(target + offsets[chunk], chunks[chunk].GetString(), chunks[chunk].GetSize());
+            target[offsets[chunk + 1] - 1] = chunk + 1 < chunkCount ? ',' : ']';
+        });
+    }
+
+    static std::string toJsonArrayParallel(const std::vector<Derived>& items, unsigned threadCount = 0) {
+        std::string out;
+        toJsonArrayParallel(items, out, threadCount);
+        return out;
+    }
+
+    // 解析JSON数组并替换items的内容, 非对象元素被忽略; 解析失败或根节点不是数组时返回false且items不变
+    static bool fromJsonArray(const std::string& jsonStr, std::vector<Derived>& items) {
+        return fromJsonArray(jsonStr.c_str(), jsonStr.size(), items);
+    }
+
+    static bool fromJsonArray(const char* data, size_t length, std::vector<Derived>& items) {
+        rapidjson::Document doc;
+        rapidjson::MemoryStream stream(data, length);
+        doc.ParseStream<rapidjson::kParseDefaultFlags, rapidjson::UTF8<> >(stream);
+
+        if (doc.HasParseError() || !doc.IsArray()) {
+            return false;
+        }
+
+        NestedArrayTraits<Derived>::deserialize(doc, &items, false);
+        return true;
+    }
+
+#ifndef _WIN32
+    static bool fromJsonArrayFile(const std::string& path, std::vector<Derived>& items) {
+        MappedFile file(path);
+        return file.isOpen() && fromJsonArray(file.getData(), file.getSize(), items);
+    }
+#endif
 };
 }
 
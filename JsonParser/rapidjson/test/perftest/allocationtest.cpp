@@ -0,0 +1,163 @@
+//
+//  allocationtest.cpp
+//  JsonParser
+//
+//  Created by 朱继超 on 10/16/26.
+//
+
+#include "serializabletest.h"
+
+// This file checks that the allocation-free paths of rapidjson::JSONSerializable stay off the heap.
+// It replaces the global allocator to count allocations, so it is built as its own executable and
+// the timings in perftest are not taken through the counting hook.
+
+#if TEST_SERIALIZABLE
+
+#include <cstdlib>
+#include <new>
+
+using namespace rapidjson;
+
+// Counts heap allocations while gCountAllocations is set. operator new is replaceable everywhere;
+// on glibc malloc is interposed as well, so allocations made through CrtAllocator are counted too.
+static bool gCountAllocations = false;
+static size_t gAllocationCount = 0;
+
+void* operator new(size_t size) {
+    if (gCountAllocations)
+        gAllocationCount++;
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+// Every replaced operator new allocates with malloc, so free matches; g++ cannot see that through
+// the replacement and reports each inlined delete as a mismatched pair.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+#if defined(__GLIBC__)
+extern "C" void* __libc_malloc(size_t);
+extern "C" void* __libc_calloc(size_t, size_t);
+extern "C" void* __libc_realloc(void*, size_t);
+
+extern "C" void* malloc(size_t size) {
+    if (gCountAllocations)
+        gAllocationCount++;
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    if (gCountAllocations)
+        gAllocationCount++;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* p, size_t size) {
+    if (gCountAllocations)
+        gAllocationCount++;
+    return __libc_realloc(p, size);
+}
+#endif
+
+// With a buffer that fits the message, decoding into fields that already have their capacity never touches the heap.
+TEST_F(Serializable, FromJson_ArenaDoesNotAllocate) {
+    std::vector<PerfPerson> people;
+    EXPECT_TRUE(PerfPerson::fromJsonArray(array_, people));
+    const std::string json = people[3].toJson();
+
+    char buffer[16 * 1024];
+    PerfPerson stacked;
+    EXPECT_TRUE(stacked.fromJson(json, buffer, sizeof(buffer)));
+    gAllocationCount = 0;
+    gCountAllocations = true;
+    const bool decoded = stacked.fromJson(json, buffer, sizeof(buffer));
+    gCountAllocations = false;
+    EXPECT_TRUE(decoded);
+    EXPECT_EQ(0u, gAllocationCount);
+    EXPECT_EQ(json, stacked.toJson());
+}
+
+TEST_F(Serializable, ToJson_FixedBufferDoesNotAllocate) {
+    std::vector<PerfPerson> people;
+    EXPECT_TRUE(PerfPerson::fromJsonArray(array_, people));
+    const PerfPerson& person = people[people.size() - 1];
+    const std::string expected = person.toJson();
+
+    char buffer[4096];
+    char tiny[8];
+    gAllocationCount = 0;
+    gCountAllocations = true;
+    const size_t length = person.toJson(buffer, sizeof(buffer));
+    const size_t required = person.toJson(tiny, sizeof(tiny));
+    gCountAllocations = false;
+
+    EXPECT_EQ(0u, gAllocationCount);
+    EXPECT_EQ(expected, std::string(buffer, length));
+    EXPECT_EQ(expected.size(), required);
+    EXPECT_EQ(expected.substr(0, sizeof(tiny)), std::string(tiny, sizeof(tiny)));
+}
+
+// Once a SerializationContext and the outputs have grown to the largest document, serializing allocates nothing.
+TEST_F(Serializable, ToJson_ContextDoesNotAllocate) {
+    std::vector<PerfPerson> people;
+    EXPECT_TRUE(PerfPerson::fromJsonArray(array_, people));
+    SerializationContext context;
+    std::string out, arrayOut;
+    StringBuffer buffer;
+    for (size_t i = 0; i < people.size(); i++) {
+        people[i].toJson(out, context);
+        people[i].toJson(buffer, context);
+    }
+    PerfPerson::toJsonArray(people, arrayOut, context);
+
+    gAllocationCount = 0;
+    gCountAllocations = true;
+    for (size_t i = 0; i < people.size(); i++) {
+        people[i].toJson(out, context);
+        people[i].toJson(buffer, context);
+    }
+    PerfPerson::toJsonArray(people, arrayOut, context);
+    gCountAllocations = false;
+
+    EXPECT_EQ(0u, gAllocationCount);
+    EXPECT_EQ(people.back().toJson(), out);
+    EXPECT_EQ(out, std::string(buffer.GetString(), buffer.GetSize()));
+    EXPECT_EQ(array_, arrayOut);
+}
+
+// The overloads without a context use the thread's default context and reach the same steady state.
+TEST_F(Serializable, ToJson_ThreadContextDoesNotAllocate) {
+    std::vector<PerfPerson> people;
+    EXPECT_TRUE(PerfPerson::fromJsonArray(array_, people));
+    std::string out, arrayOut;
+    StringBuffer buffer;
+    for (size_t i = 0; i < people.size(); i++) {
+        people[i].toJson(out);
+        people[i].toJson(buffer);
+    }
+    PerfPerson::toJsonArray(people, arrayOut);
+
+    gAllocationCount = 0;
+    gCountAllocations = true;
+    for (size_t i = 0; i < people.size(); i++) {
+        people[i].toJson(out);
+        people[i].toJson(buffer);
+    }
+    PerfPerson::toJsonArray(people, arrayOut);
+    gCountAllocations = false;
+
+    EXPECT_EQ(0u, gAllocationCount);
+    EXPECT_EQ(people.back().toJson(), out);
+    EXPECT_EQ(out, std::string(buffer.GetString(), buffer.GetSize()));
+    EXPECT_EQ(array_, arrayOut);
+}
+
+#endif // TEST_SERIALIZABLE
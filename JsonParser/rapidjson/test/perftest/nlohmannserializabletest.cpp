@@ -0,0 +1,399 @@
+//
+//  nlohmannserializabletest.cpp
+//  JsonParser
+//
+//  Created by 朱继超 on 10/16/26.
+//
+
+#include "perftest.h"
+#include "serializabletestcommon.h"
+
+// Tests for nlohmann::JSONSerializable: each decoding path (DOM, SAX, length-delimited, files and push parsing)
+// is checked against the nlohmann DOM or against expected values, mirroring the rapidjson tests in serializabletest.cpp.
+
+#if TEST_SERIALIZABLE
+
+#include "nlohmann_json_wrapper.hpp"
+#include "nlohmann_json_push_parser.hpp"
+
+namespace {
+
+class NlohmannAddress : public nlohmann::JSONSerializable<NlohmannAddress> {
+public:
+    std::string street;
+    std::string city;
+    std::string zipCode;
+
+    NlohmannAddress() {
+        registerProperty("street", street);
+        registerProperty("city", city);
+        registerProperty("zipCode", zipCode);
+    }
+};
+
+class NlohmannPerson : public nlohmann::JSONSerializable<NlohmannPerson> {
+public:
+    std::string name;
+    int age;
+    NlohmannAddress homeAddress;
+    std::vector<NlohmannAddress> pastAddresses;
+
+    NlohmannPerson() : age(0) {
+        registerProperty("name", name);
+        registerProperty("age", age);
+        registerNestedObject("homeAddress", homeAddress);
+        registerNestedArray("pastAddresses", pastAddresses);
+    }
+};
+
+// Derives from a serializable type and registers a member of its own, which the schema of NlohmannPerson cannot hold.
+class NlohmannAdmin : public NlohmannPerson {
+public:
+    int level;
+
+    NlohmannAdmin() : level(0) {
+        registerProperty("level", level);
+    }
+};
+
+enum class NlohmannLevel { Low, Mid, High };
+
+class NlohmannProfile : public nlohmann::JSONSerializable<NlohmannProfile> {
+public:
+    std::string name;
+    int age;
+    unsigned int visits;
+    uint64_t id;
+    double score;
+    bool active;
+    NlohmannLevel level;
+    NlohmannAddress homeAddress;
+    std::vector<NlohmannPerson> friends;
+
+    NlohmannProfile() : age(0), visits(0), id(0), score(0), active(false), level(NlohmannLevel::Low) {
+        auto& levels = nlohmann::EnumSerializer<NlohmannLevel>::instance();
+        levels.registerValue("low", NlohmannLevel::Low);
+        levels.registerValue("mid", NlohmannLevel::Mid);
+        levels.registerValue("high", NlohmannLevel::High);
+
+        registerProperty("name", name);
+        registerProperty("age", age);
+        registerProperty("visits", visits);
+        registerProperty("id", id);
+        registerProperty("score", score);
+        registerProperty("active", active);
+        registerEnum("level", level);
+        registerNestedObject("homeAddress", homeAddress);
+        registerNestedArray("friends", friends);
+    }
+};
+
+// More properties than ClassSchema scans linearly, so every key is looked up through the perfect hash.
+class NlohmannWide : public nlohmann::JSONSerializable<NlohmannWide> {
+public:
+    static const int kGroupSize = 13;
+
+    std::string strings[kGroupSize];
+    int ints[kGroupSize];
+    double doubles[kGroupSize];
+    bool flags[kGroupSize];
+    NlohmannAddress address;
+    std::vector<NlohmannAddress> addresses;
+
+    NlohmannWide() {
+        for (int i = 0; i < kGroupSize; i++) {
+            ints[i] = 0;
+            doubles[i] = 0;
+            flags[i] = false;
+            registerProperty("s" + std::to_string(i), strings[i]);
+            registerProperty("int_" + std::to_string(i), ints[i]);
+            registerProperty("doubleValue" + std::to_string(i * 7), doubles[i]);
+            registerProperty("flag_" + std::string(static_cast<size_t>(i % 3 + 1), 'f') + std::to_string(i), flags[i]);
+        }
+        registerNestedObject("address", address);
+        registerNestedArray("addresses", addresses);
+    }
+
+    void Fill() {
+        for (int i = 0; i < kGroupSize; i++) {
+            strings[i] = "string " + std::to_string(i);
+            ints[i] = i * 1000 - 5000;
+            doubles[i] = i + 0.5;
+            flags[i] = i % 2 == 0;
+        }
+        address.city = "Wide City";
+        addresses.resize(2);
+        addresses[1].street = "2 Wide Street";
+    }
+};
+
+std::vector<std::string> RegisteredKeys(const nlohmann::ClassSchema& schema) {
+    std::vector<std::string> keys;
+    for (const nlohmann::PropertyDescriptor& p : schema.getProperties())
+        keys.push_back(p.key);
+    return keys;
+}
+
+// Registered only by EnumSerializer_ConcurrentRegistration.
+enum class NlohmannShade { Light, Medium, Dark, Black };
+
+} // namespace
+
+// Elements of a nested array that are not objects are skipped by every decode path, not default-constructed.
+TEST(NlohmannSerializable, FromJson_NestedArraySkipsNonObjects) {
+    const std::string json =
+        "{\"name\":\"n\",\"pastAddresses\":[{\"city\":\"A\"},1,\"x\",null,true,[{\"city\":\"B\"}],{},{\"city\":\"C\"}]}";
+    const std::string expected =
+        "[{\"city\":\"A\",\"street\":\"\",\"zipCode\":\"\"},"
+        "{\"city\":\"\",\"street\":\"\",\"zipCode\":\"\"},"
+        "{\"city\":\"C\",\"street\":\"\",\"zipCode\":\"\"}]";
+
+    NlohmannPerson dom, sax;
+    EXPECT_TRUE(dom.fromJson(json));
+    EXPECT_TRUE(sax.fromJsonSax(json));
+    EXPECT_EQ(expected, NlohmannAddress::toJsonArray(dom.pastAddresses));
+    EXPECT_EQ(expected, NlohmannAddress::toJsonArray(sax.pastAddresses));
+
+    std::vector<NlohmannAddress> items;
+    EXPECT_TRUE(NlohmannAddress::fromJsonArray("[{\"city\":\"A\"},1,\"x\",null,true,[{\"city\":\"B\"}],{},{\"city\":\"C\"}]", items));
+    EXPECT_EQ(expected, NlohmannAddress::toJsonArray(items));
+}
+
+TEST(NlohmannSerializable, FromJsonSax_MatchesDocument) {
+    const char* inputs[] = {
+        // Every kind of property, with nested objects inside array elements and unknown keys at every level.
+        "{\"name\":\"Ann \\\"A\\\"\",\"age\":-41,\"visits\":7,\"id\":18446744073709551615,\"score\":2.5,"
+        "\"active\":true,\"level\":\"high\",\"extra\":{\"a\":[1,{\"b\":2}]},"
+        "\"homeAddress\":{\"street\":\"1 Main\",\"city\":\"X\",\"unknown\":[[]]},"
+        "\"friends\":[{\"name\":\"Bob\",\"age\":30,\"homeAddress\":{\"city\":\"Y\"},"
+        "\"pastAddresses\":[{\"city\":\"P1\"},{\"zipCode\":\"Z\",\"more\":{}}]},{},{\"name\":\"Cy\"}]}",
+        // Enums given by number, integers where doubles are expected, and an empty nested array.
+        "{\"level\":1,\"score\":3,\"friends\":[],\"homeAddress\":{}}",
+        // Values of the wrong type leave the fields unchanged.
+        "{\"name\":5,\"age\":\"old\",\"visits\":-1,\"id\":1.5,\"active\":1,\"level\":\"none\","
+        "\"homeAddress\":[1],\"friends\":{\"name\":\"x\"}}",
+    };
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        NlohmannProfile dom, sax;
+        EXPECT_TRUE(dom.fromJson(inputs[i]));
+        EXPECT_TRUE(sax.fromJsonSax(inputs[i]));
+        EXPECT_EQ(dom.toJson(), sax.toJson()) << inputs[i];
+    }
+
+    NlohmannProfile profile;
+    EXPECT_TRUE(profile.fromJsonSax(inputs[0]));
+    EXPECT_EQ("Ann \"A\"", profile.name);
+    EXPECT_EQ(-41, profile.age);
+    EXPECT_EQ(18446744073709551615ull, profile.id);
+    EXPECT_TRUE(NlohmannLevel::High == profile.level);
+    EXPECT_EQ("X", profile.homeAddress.city);
+    ASSERT_EQ(3u, profile.friends.size());
+    EXPECT_EQ("Y", profile.friends[0].homeAddress.city);
+    ASSERT_EQ(2u, profile.friends[0].pastAddresses.size());
+    EXPECT_EQ("Z", profile.friends[0].pastAddresses[1].zipCode);
+    EXPECT_EQ("Cy", profile.friends[2].name);
+
+    EXPECT_TRUE(profile.fromJsonSax(inputs[1]));
+    EXPECT_TRUE(NlohmannLevel::Mid == profile.level);
+    EXPECT_EQ(3.0, profile.score);
+    EXPECT_TRUE(profile.friends.empty());
+}
+
+// Syntax errors throw json::parse_error from both decode paths; a root that is not an object returns false.
+TEST(NlohmannSerializable, FromJsonSax_MalformedInput) {
+    const char* malformed[] = { "", "{", "{\"name\":\"x\",", "{\"name\" \"x\"}", "{\"friends\":[{]}", "{} {}" };
+    for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++) {
+        NlohmannProfile profile;
+        EXPECT_THROW(profile.fromJson(malformed[i]), nlohmann::json::parse_error) << malformed[i];
+        EXPECT_THROW(profile.fromJsonSax(malformed[i]), nlohmann::json::parse_error) << malformed[i];
+    }
+
+    const char* notObjects[] = { "[]", "[{\"name\":\"x\"}]", "5", "\"x\"", "null" };
+    for (size_t i = 0; i < sizeof(notObjects) / sizeof(notObjects[0]); i++) {
+        NlohmannProfile profile;
+        EXPECT_FALSE(profile.fromJson(notObjects[i])) << notObjects[i];
+        EXPECT_FALSE(profile.fromJsonSax(notObjects[i])) << notObjects[i];
+        EXPECT_EQ("", profile.name);
+    }
+}
+
+// fromJson(data, length) stops at data + length: the input need not end in '\0', and the bytes after it are ignored.
+TEST(NlohmannSerializable, FromJson_LengthDelimited) {
+    const std::string json = "{\"name\":\"Ann\",\"age\":3,\"pastAddresses\":[{\"city\":\"P\"}]}";
+    std::vector<char> buffer(json.begin(), json.end());
+    const std::string trailer = "{\"name\":\"garbage\"}";
+    buffer.insert(buffer.end(), trailer.begin(), trailer.end());
+
+    NlohmannPerson person;
+    EXPECT_TRUE(person.fromJson(buffer.data(), json.size()));
+    EXPECT_EQ("Ann", person.name);
+    EXPECT_EQ(3, person.age);
+    ASSERT_EQ(1u, person.pastAddresses.size());
+    EXPECT_THROW(person.fromJson(buffer.data(), buffer.size()), nlohmann::json::parse_error);
+    EXPECT_THROW(person.fromJson(buffer.data(), json.size() - 1), nlohmann::json::parse_error);
+
+#if __cplusplus >= 201703L
+    NlohmannPerson viewed;
+    EXPECT_TRUE(viewed.fromJson(std::string_view(buffer.data(), json.size())));
+    EXPECT_EQ(person.toJson(), viewed.toJson());
+#endif
+}
+
+TEST(NlohmannSerializable, FindProperty_PerfectHashMatchesLinearScan) {
+    const nlohmann::ClassSchema& schema = NlohmannWide::schema();
+    const std::vector<nlohmann::PropertyDescriptor>& properties = schema.getProperties();
+    ASSERT_LE(50u, properties.size());
+
+    for (const nlohmann::PropertyDescriptor& p : properties)
+        EXPECT_EQ(&p, schema.findProperty(p.key));
+
+    // Most unknown keys hash into a slot that holds a registered key, so the final key comparison has to reject them.
+    nlohmann::PropertyIndex index;
+    index.build(properties);
+    size_t occupied = 0;
+    const std::vector<std::string> unknown = MakeUnknownKeys(RegisteredKeys(schema));
+    for (const std::string& key : unknown) {
+        EXPECT_TRUE(schema.findProperty(key) == 0) << key;
+        if (index.find(key) >= 0)
+            occupied++;
+    }
+    EXPECT_LT(unknown.size() / 2, occupied);
+}
+
+TEST(NlohmannSerializable, FromJson_WideObject) {
+    NlohmannWide wide;
+    wide.Fill();
+    const std::string expected = wide.toJson();
+
+    // The same members plus every unknown key, each carrying a nested value.
+    nlohmann::json doc = nlohmann::json::parse(expected);
+    const std::vector<std::string> unknown = MakeUnknownKeys(RegisteredKeys(NlohmannWide::schema()));
+    for (const std::string& key : unknown)
+        doc[key] = nlohmann::json::array({ { { "city", "Unknown" } } });
+    const std::string json = doc.dump();
+
+    NlohmannWide dom, sax;
+    EXPECT_TRUE(dom.fromJson(json));
+    EXPECT_TRUE(sax.fromJsonSax(json));
+    EXPECT_EQ(expected, dom.toJson());
+    EXPECT_EQ(expected, sax.toJson());
+
+    // Dispatching each member through a linear scan of the properties gives the same object.
+    const std::vector<nlohmann::PropertyDescriptor>& properties = NlohmannWide::schema().getProperties();
+    NlohmannWide linear;
+    for (auto it = doc.begin(); it != doc.end(); ++it) {
+        for (const nlohmann::PropertyDescriptor& p : properties) {
+            if (p.key == it.key()) {
+                nlohmann::ClassSchema::deserializeProperty(p, it.value(), &linear);
+                break;
+            }
+        }
+    }
+    EXPECT_EQ(expected, linear.toJson());
+}
+
+// A subclass that registers members fails loudly on construction instead of dropping those members.
+TEST(NlohmannSerializable, Schema_DerivedClassRegistration) {
+    EXPECT_THROW(NlohmannAdmin(), std::logic_error);
+}
+
+// Parallel output matches toJsonArray byte for byte, whether it runs as one chunk, several, or more threads than elements.
+TEST(NlohmannSerializable, ToJsonArrayParallel_MatchesSequential) {
+    std::vector<NlohmannPerson> people(5 * nlohmann::kParallelChunkItems + 7);
+    for (size_t i = 0; i < people.size(); i++) {
+        people[i].name = "Person " + std::to_string(i);
+        people[i].age = static_cast<int>(i % 90);
+        people[i].homeAddress.city = i % 2 ? "Beijing" : "Shanghai";
+        people[i].pastAddresses.resize(i % 3);
+    }
+    const std::string expected = NlohmannPerson::toJsonArray(people);
+
+    const unsigned threadCounts[] = { 0, 1, 2, 3, 5, 8, static_cast<unsigned>(people.size() + 1) };
+    for (size_t i = 0; i < sizeof(threadCounts) / sizeof(threadCounts[0]); i++) {
+        std::string out = "stale";
+        NlohmannPerson::toJsonArrayParallel(people, out, threadCounts[i]);
+        EXPECT_EQ(expected, out) << threadCounts[i];
+    }
+
+    // Below the chunk threshold, and with nothing to write, the sequential path produces the same bytes.
+    std::vector<NlohmannPerson> few(people.begin(), people.begin() + 3);
+    EXPECT_EQ(NlohmannPerson::toJsonArray(few), NlohmannPerson::toJsonArrayParallel(few, 4));
+    std::vector<NlohmannPerson> none;
+    EXPECT_EQ("[]", NlohmannPerson::toJsonArrayParallel(none, 4));
+}
+
+// A failure in any chunk, whether on the calling thread or a worker, reaches the caller once every thread has finished.
+TEST(NlohmannSerializable, ToJsonArrayParallel_RethrowsChunkFailure) {
+    std::vector<NlohmannPerson> people(4 * nlohmann::kParallelChunkItems);
+    for (size_t i = 0; i < people.size(); i++)
+        people[i].name = "Person " + std::to_string(i);
+
+    const size_t failing[] = { 0, people.size() - 1 };
+    for (size_t i = 0; i < sizeof(failing) / sizeof(failing[0]); i++) {
+        std::vector<NlohmannPerson> broken(people);
+        broken[failing[i]].name = "\xff";
+        std::string out;
+        EXPECT_THROW(NlohmannPerson::toJsonArrayParallel(broken, out, 4), nlohmann::json::type_error) << failing[i];
+    }
+    EXPECT_EQ(NlohmannPerson::toJsonArray(people), NlohmannPerson::toJsonArrayParallel(people, 4));
+}
+
+TEST(NlohmannSerializable, EnumSerializer_ConcurrentRegistration) {
+    TestConcurrentEnumRegistration<nlohmann::EnumSerializer, NlohmannShade>();
+}
+
+#ifndef _WIN32
+// Mapped files decode whether or not their size is a multiple of the page size; missing files fail and empty files are syntax errors.
+TEST(NlohmannSerializable, FromJsonFile_Boundaries) {
+    std::vector<NlohmannPerson> expected(40);
+    for (size_t i = 0; i < expected.size(); i++) {
+        expected[i].name = "Person " + std::to_string(i);
+        expected[i].age = static_cast<int>(i);
+        expected[i].homeAddress.street = std::string(i * 7, 'x');
+    }
+    const std::string array = NlohmannPerson::toJsonArray(expected);
+    const std::string single = expected.back().toJson();
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+    std::vector<NlohmannPerson> people;
+    NlohmannPerson person;
+    std::string path = TempPathWith("");
+    ASSERT_FALSE(path.empty());
+    EXPECT_THROW(NlohmannPerson::fromJsonArrayFile(path, people), nlohmann::json::parse_error);
+    EXPECT_THROW(person.fromJsonFile(path), nlohmann::json::parse_error);
+    remove(path.c_str());
+    EXPECT_FALSE(NlohmannPerson::fromJsonArrayFile(path, people));
+    EXPECT_FALSE(person.fromJsonFile(path));
+
+    // A document cut off at a page boundary fails without reading past the mapping.
+    ASSERT_LT(page, array.size());
+    path = TempPathWith(array.substr(0, page));
+    ASSERT_FALSE(path.empty());
+    EXPECT_THROW(NlohmannPerson::fromJsonArrayFile(path, people), nlohmann::json::parse_error);
+    remove(path.c_str());
+
+    // Trailing spaces pad the array to one byte short of, exactly, and one byte past a page boundary.
+    const size_t aligned = (array.size() / page + 1) * page;
+    const size_t sizes[] = { array.size(), aligned - 1, aligned, aligned + 1 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        path = TempPathWith(array + std::string(sizes[i] - array.size(), ' '));
+        ASSERT_FALSE(path.empty());
+        people.clear();
+        EXPECT_TRUE(NlohmannPerson::fromJsonArrayFile(path, people)) << sizes[i];
+        EXPECT_EQ(array, NlohmannPerson::toJsonArray(people));
+        remove(path.c_str());
+    }
+
+    path = TempPathWith(single);
+    ASSERT_FALSE(path.empty());
+    EXPECT_TRUE(person.fromJsonFile(path));
+    EXPECT_EQ(single, person.toJson());
+    remove(path.c_str());
+}
+#endif
+
+TEST(NlohmannSerializable, JsonPushParser_Framing) {
+    TestPushParserFraming<nlohmann::JsonPushParser<NlohmannPerson>, NlohmannPerson>();
+}
+
+#endif // TEST_SERIALIZABLE
@@ -18,6 +18,7 @@
 #define TEST_RAPIDJSON  1
 #define TEST_PLATFORM   0
 #define TEST_MISC       0
+#define TEST_SERIALIZABLE 1
 
 #define TEST_VERSION_CODE(x,y,z) \
   (((x)*100000) + ((y)*100) + (z))
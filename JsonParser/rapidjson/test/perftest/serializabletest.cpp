@@ -0,0 +1,1196 @@
+//
+//  serializabletest.cpp
+//  JsonParser
+//
+//  Created by 朱继超 on 10/16/26.
+//
+
+#include "serializabletest.h"
+#include "serializabletestcommon.h"
+
+// This file compares the decode and encode paths of rapidjson::JSONSerializable on a payload as large as sample.json.
+
+#if TEST_SERIALIZABLE
+
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+using namespace rapidjson;
+
+namespace {
+
+class PerfBorrowedTag : public JSONSerializable<PerfBorrowedTag> {
+public:
+    BorrowedString label;
+
+    PerfBorrowedTag() {
+        registerProperty("label", label);
+    }
+};
+
+// Borrowed strings at the top level, in a nested object and in nested array elements, next to an owned string.
+class PerfBorrowed : public JSONSerializable<PerfBorrowed> {
+public:
+    BorrowedString name;
+    std::string city;
+    PerfBorrowedTag tag;
+    std::vector<PerfBorrowedTag> tags;
+
+    PerfBorrowed() {
+        registerProperty("name", name);
+        registerProperty("city", city);
+        registerNestedObject("tag", tag);
+        registerNestedArray("tags", tags);
+    }
+
+    // Whether every borrowed field points into [begin, end).
+    bool BorrowsFrom(const char* begin, const char* end) const {
+        bool inside = Inside(name, begin, end) && Inside(tag.label, begin, end);
+        for (const PerfBorrowedTag& t : tags)
+            inside = inside && Inside(t.label, begin, end);
+        return inside;
+    }
+
+private:
+    static bool Inside(const BorrowedString& s, const char* begin, const char* end) {
+        return s.data() >= begin && s.data() + s.size() <= end;
+    }
+};
+
+#if __cplusplus >= 201703L
+class PerfViewed : public JSONSerializable<PerfViewed> {
+public:
+    std::string_view name;
+    std::vector<PerfBorrowedTag> tags;
+
+    PerfViewed() {
+        registerProperty("name", name);
+        registerNestedArray("tags", tags);
+    }
+};
+#endif
+
+// More properties than ClassSchema scans linearly, so every key is looked up through the perfect hash.
+class PerfWide : public JSONSerializable<PerfWide> {
+public:
+    static const int kGroupSize = 13;
+
+    std::string strings[kGroupSize];
+    int ints[kGroupSize];
+    double doubles[kGroupSize];
+    bool flags[kGroupSize];
+    PerfAddress address;
+    std::vector<PerfAddress> addresses;
+
+    PerfWide() {
+        for (int i = 0; i < kGroupSize; i++) {
+            ints[i] = 0;
+            doubles[i] = 0;
+            flags[i] = false;
+            registerProperty("s" + std::to_string(i), strings[i]);
+            registerProperty("int_" + std::to_string(i), ints[i]);
+            registerProperty("doubleValue" + std::to_string(i * 7), doubles[i]);
+            registerProperty("flag_" + std::string(static_cast<size_t>(i % 3 + 1), 'f') + std::to_string(i), flags[i]);
+        }
+        registerNestedObject("address", address);
+        registerNestedArray("addresses", addresses);
+    }
+
+    void Fill() {
+        for (int i = 0; i < kGroupSize; i++) {
+            strings[i] = "string " + std::to_string(i);
+            ints[i] = i * 1000 - 5000;
+            doubles[i] = i + 0.5;
+            flags[i] = i % 2 == 0;
+        }
+        address.city = "Wide City";
+        addresses.resize(2);
+        addresses[1].street = "2 Wide Street";
+    }
+};
+
+// Registered only by EnumSerializer_ConcurrentRegistration.
+enum class PerfShade { Light, Medium, Dark, Black };
+
+// Only Low and Mid have names; High and Unnamed are left out of the output.
+enum class PerfSizeLevel { Low, Mid, High, Unnamed };
+
+// One property of every scalar kind, for checking serializedSize against toJson.
+class PerfSized : public JSONSerializable<PerfSized> {
+public:
+    int i;
+    unsigned int u;
+    uint64_t big;
+    double d;
+    bool flag;
+    PerfSizeLevel level;
+    std::string text;
+    PerfAddress address;
+    std::vector<PerfAddress> history;
+
+    PerfSized() : i(0), u(0), big(0), d(0), flag(false), level(PerfSizeLevel::Low) {
+        auto& levels = EnumSerializer<PerfSizeLevel>::instance();
+        levels.registerValue("low", PerfSizeLevel::Low);
+        levels.registerValue("m\tid", PerfSizeLevel::Mid);
+
+        registerProperty("i", i);
+        registerProperty("u", u);
+        registerProperty("big", big);
+        registerProperty("d", d);
+        registerProperty("flag", flag);
+        registerEnum("level", level);
+        registerProperty("te\"xt", text);
+        registerNestedObject("address", address);
+        registerNestedArray("history", history);
+    }
+};
+
+// Derives from a serializable type and registers a member of its own, which the schema of PerfPerson cannot hold.
+class PerfAdmin : public PerfPerson {
+public:
+    int level;
+
+    PerfAdmin() : level(0) {
+        registerProperty("level", level);
+    }
+};
+
+// Derives from a serializable type without registering anything, and serializes as a PerfPerson.
+class PerfGuest : public PerfPerson {
+public:
+    void visit() { visits++; }
+};
+
+} // namespace
+
+TEST_F(Serializable, FromJson_Document) {
+    for (size_t i = 0; i < kTrialCount; i++) {
+        PerfRoster roster;
+        EXPECT_TRUE(roster.fromJson(payload_));
+    }
+}
+
+TEST_F(Serializable, FromJsonSax_Reader) {
+    for (size_t i = 0; i < kTrialCount; i++) {
+        PerfRoster roster;
+        EXPECT_TRUE(roster.fromJsonSax(payload_));
+    }
+}
+
+TEST_F(Serializable, FromJsonSax_MatchesDocument) {
+    PerfRoster dom, sax;
+    EXPECT_TRUE(dom.fromJson(payload_));
+    EXPECT_TRUE(sax.fromJsonSax(payload_));
+    EXPECT_EQ(payload_, dom.toJson());
+    EXPECT_EQ(payload_, sax.toJson());
+}
+
+TEST_F(Serializable, FromJson_Arena) {
+    std::vector<PerfPerson> people;
+    EXPECT_TRUE(PerfPerson::fromJsonArray(array_, people));
+    const std::string json = people[3].toJson();
+    ASSERT_EQ(3u, people[3].pastAddresses.size());
+
+    // An arena that outgrows its initial buffer still decodes everything and can be cleared as soon as the call returns.
+    char small[64];
+    MemoryPoolAllocator<> arena(small, sizeof(small));
+    PerfPerson pooled;
+    EXPECT_TRUE(pooled.fromJson(json, arena));
+    EXPECT_LT(sizeof(small), arena.Capacity());
+    arena.Clear();
+    EXPECT_EQ(json, pooled.toJson());
+
+    PerfPerson stacked;
+    EXPECT_TRUE(stacked.fromJson(json, small, sizeof(small)));
+    EXPECT_EQ(json, stacked.toJson());
+
+    // allocationtest.cpp checks that a buffer which fits the message keeps decoding off the heap.
+    char buffer[16 * 1024];
+    EXPECT_TRUE(stacked.fromJson(json, buffer, sizeof(buffer)));
+    EXPECT_EQ(json, stacked.toJson());
+
+    EXPECT_FALSE(stacked.fromJson("{\"name\":", buffer, sizeof(buffer)));
+    EXPECT_FALSE(pooled.fromJson("[{}]", arena));
+    EXPECT_EQ(json, stacked.toJson());
+}
+
+// fromJsonInsitu reads exactly len bytes: the buffer need not end in '\0', and the bytes after it are neither read nor written.
+TEST_F(Serializable, FromJsonInsitu_BoundedBuffer) {
+    std::vector<PerfPerson> people;
+    EXPECT_TRUE(PerfPerson::fromJsonArray(array_, people));
+    const std::string json = people[3].toJson();
+
+    const std::string trailer = "}],\"name\":\"garbage\"}";
+    std::vector<char> buffer(json.begin(), json.end());
+    buffer.insert(buffer.end(), trailer.begin(), trailer.end());
+    PerfPerson person;
+    EXPECT_TRUE(person.fromJsonInsitu(buffer.data(), json.size()));
+    EXPECT_EQ(json, person.toJson());
+    EXPECT_EQ(trailer, std::string(buffer.data() + json.size(), trailer.size()));
+
+    // Truncated input fails. Each buffer is sized exactly, so AddressSanitizer reports any read past its end.
+    for (size_t length = 0; length < json.size(); length += 5) {
+        std::vector<char> truncated(json.begin(), json.begin() + static_cast<std::ptrdiff_t>(length));
+        PerfPerson partial;
+        EXPECT_FALSE(partial.fromJsonInsitu(truncated.data(), truncated.size())) << length;
+    }
+
+    char text[] = { '"', 'a', '"', 'x' };
+    BoundedInsituStringStream stream(text, 3);
+    EXPECT_EQ('"', stream.Take());
+    EXPECT_EQ('a', stream.Take());
+    EXPECT_EQ('"', stream.Take());
+    EXPECT_EQ('\0', stream.Peek());
+    EXPECT_EQ('\0', stream.Take());
+    EXPECT_EQ(3u, stream.Tell());
+}
+
+static const char kBorrowedJson[] =
+    "{\"name\":\"Ann\",\"city\":\"Paris\",\"tag\":{\"label\":\"a\\tb\"},\"tags\":[{\"label\":\"x\"},{\"label\":\"yz\"}]}";
+
+// Borrowed fields are filled only by the entry points whose input outlives the call, and then point into that input.
+TEST_F(Serializable, BorrowedString_PointsIntoRetainedInput) {
+    const std::string json = kBorrowedJson;
+
+    // In situ: into the caller's buffer, with escapes decoded in place.
+    std::vector<char> buffer(json.begin(), json.end());
+    PerfBorrowed insitu;
+    EXPECT_TRUE(insitu.fromJsonInsitu(buffer.data(), buffer.size()));
+    EXPECT_TRUE(insitu.BorrowsFrom(buffer.data(), buffer.data() + buffer.size()));
+    EXPECT_EQ(BorrowedString("Ann", 3), insitu.name);
+    EXPECT_EQ(BorrowedString("a\tb", 3), insitu.tag.label);
+    ASSERT_EQ(2u, insitu.tags.size());
+    EXPECT_EQ(BorrowedString("yz", 2), insitu.tags[1].label);
+    EXPECT_EQ(json, insitu.toJson());
+
+    // fromValue: into the caller's document.
+    Document doc;
+    doc.Parse(json.c_str());
+    PerfBorrowed fromDoc;
+    EXPECT_TRUE(fromDoc.fromValue(doc));
+    EXPECT_EQ(doc["name"].GetString(), fromDoc.name.data());
+    EXPECT_EQ(doc["tag"]["label"].GetString(), fromDoc.tag.label.data());
+    EXPECT_EQ(doc["tags"][1]["label"].GetString(), fromDoc.tags[1].label.data());
+    EXPECT_NE(doc["city"].GetString(), fromDoc.city.data());
+
+    // SAX with kParseInsituFlag: into the stream's buffer.
+    std::vector<char> saxBuffer(json.begin(), json.end());
+    saxBuffer.push_back('\0');
+    InsituStringStream stream(saxBuffer.data());
+    PerfBorrowed sax;
+    EXPECT_TRUE(sax.fromJsonStream<kParseInsituFlag>(stream));
+    EXPECT_TRUE(sax.BorrowsFrom(saxBuffer.data(), saxBuffer.data() + saxBuffer.size()));
+    EXPECT_EQ(json, sax.toJson());
+
+    // A caller's arena: the strings are read back before the arena is cleared.
+    MemoryPoolAllocator<> arena;
+    PerfBorrowed pooled;
+    EXPECT_TRUE(pooled.fromJson(json, arena));
+    EXPECT_EQ(json, pooled.toJson());
+    EXPECT_FALSE(pooled.BorrowsFrom(json.data(), json.data() + json.size()));
+}
+
+// With borrowing off, owned strings are copied and borrowed fields keep what they pointed at before.
+TEST_F(Serializable, BorrowedString_NotFilledFromTransientInput) {
+    const std::string json = kBorrowedJson;
+    const char* previous = "previous";
+
+    Document doc;
+    doc.Parse(json.c_str());
+    PerfBorrowed copied;
+    copied.name = BorrowedString(previous, 8);
+    EXPECT_TRUE(copied.fromValue(doc, false));
+    EXPECT_EQ(previous, copied.name.data());
+    EXPECT_TRUE(copied.tag.label.empty());
+    ASSERT_EQ(2u, copied.tags.size());
+    EXPECT_TRUE(copied.tags[1].label.empty());
+    EXPECT_EQ("Paris", copied.city);
+    EXPECT_NE(doc["city"].GetString(), copied.city.data());
+
+    PerfBorrowed dom, sax, stacked;
+    char buffer[4096];
+    dom.name = sax.name = stacked.name = BorrowedString(previous, 8);
+    EXPECT_TRUE(dom.fromJson(json));
+    EXPECT_TRUE(sax.fromJsonSax(json));
+    EXPECT_TRUE(stacked.fromJson(json, buffer, sizeof(buffer)));
+    EXPECT_EQ(previous, dom.name.data());
+    EXPECT_EQ(previous, sax.name.data());
+    EXPECT_EQ(previous, stacked.name.data());
+    EXPECT_EQ("Paris", sax.city);
+}
+
+// fromJson(data, length) stops at data + length: the input need not end in '\0', and the bytes after it are ignored.
+TEST_F(Serializable, FromJson_LengthDelimited) {
+    std::vector<PerfPerson> people;
+    EXPECT_TRUE(PerfPerson::fromJsonArray(array_, people));
+    const std::string json = people[3].toJson();
+
+    std::vector<char> buffer(json.begin(), json.end());
+    const std::string trailer = "{\"name\":\"garbage\"}";
+    buffer.insert(buffer.end(), trailer.begin(), trailer.end());
+    PerfPerson person;
+    EXPECT_TRUE(person.fromJson(buffer.data(), json.size()));
+    EXPECT_EQ(json, person.toJson());
+    EXPECT_FALSE(person.fromJson(buffer.data(), buffer.size()));
+
+    // Each truncated prefix is sized exactly, so AddressSanitizer reports any read past its end.
+    for (size_t length = 0; length < json.size(); length += 5) {
+        std::vector<char> truncated(json.begin(), json.begin() + static_cast<std::ptrdiff_t>(length));
+        PerfPerson partial;
+        EXPECT_FALSE(partial.fromJson(truncated.data(), truncated.size())) << length;
+    }
+
+#if __cplusplus >= 201703L
+    PerfPerson viewed;
+    EXPECT_TRUE(viewed.fromJson(std::string_view(buffer.data(), json.size())));
+    EXPECT_EQ(json, viewed.toJson());
+
+    // std::string_view fields borrow like BorrowedString.
+    std::string viewJson = "{\"name\":\"Ann\",\"tags\":[{\"label\":\"x\"}]}";
+    PerfViewed borrowed;
+    EXPECT_TRUE(borrowed.fromJsonInsitu(&viewJson[0], viewJson.size()));
+    EXPECT_EQ("Ann", borrowed.name);
+    EXPECT_TRUE(borrowed.name.data() > viewJson.data() && borrowed.name.data() < viewJson.data() + viewJson.size());
+    EXPECT_EQ("{\"name\":\"Ann\",\"tags\":[{\"label\":\"x\"}]}", borrowed.toJson());
+#endif
+}
+
+// Elements of a nested array that are not objects are skipped by every decode path, not default-constructed.
+TEST_F(Serializable, FromJson_NestedArraySkipsNonObjects) {
+    const std::string json =
+        "{\"name\":\"n\",\"pastAddresses\":[{\"city\":\"A\"},1,\"x\",null,true,[{\"city\":\"B\"}],{},{\"city\":\"C\"}]}";
+    const std::string expected =
+        "[{\"street\":\"\",\"city\":\"A\",\"zipCode\":\"\"},"
+        "{\"street\":\"\",\"city\":\"\",\"zipCode\":\"\"},"
+        "{\"street\":\"\",\"city\":\"C\",\"zipCode\":\"\"}]";
+
+    PerfPerson dom, sax;
+    EXPECT_TRUE(dom.fromJson(json));
+    EXPECT_TRUE(sax.fromJsonSax(json));
+    EXPECT_EQ(expected, PerfAddress::toJsonArray(dom.pastAddresses));
+    EXPECT_EQ(expected, PerfAddress::toJsonArray(sax.pastAddresses));
+
+    const std::string array = "[{\"city\":\"A\"},1,\"x\",null,true,[{\"city\":\"B\"}],{},{\"city\":\"C\"}]";
+    std::vector<PerfAddress> items, streamed;
+    EXPECT_TRUE(PerfAddress::fromJsonArray(array, items));
+    StringStream stream(array.c_str());
+    EXPECT_TRUE(PerfAddress::fromJsonArrayStream(stream, [&streamed](PerfAddress& a) { streamed.push_back(a); }));
+    EXPECT_EQ(expected, PerfAddress::toJsonArray(items));
+    EXPECT_EQ(expected, PerfAddress::toJsonArray(streamed));
+}
+
+static std::vector<std::string> RegisteredKeys(const ClassSchema& schema) {
+    std::vector<std::string> keys;
+    for (const PropertyDescriptor& p : schema.getProperties())
+        keys.push_back(std::string(p.key, p.keyLength));
+    return keys;
+}
+
+TEST_F(Serializable, FindProperty_PerfectHashMatchesLinearScan) {
+    const ClassSchema& schema = PerfWide::schema();
+    const std::vector<PropertyDescriptor>& properties = schema.getProperties();
+    ASSERT_LE(50u, properties.size());
+
+    for (const PropertyDescriptor& p : properties)
+        EXPECT_EQ(&p, schema.findProperty(p.key, p.keyLength));
+
+    // Most unknown keys hash into a slot that holds a registered key, so the final key comparison has to reject them.
+    PropertyIndex index;
+    index.build(properties);
+    size_t occupied = 0;
+    const std::vector<std::string> unknown = MakeUnknownKeys(RegisteredKeys(schema));
+    for (const std::string& key : unknown) {
+        const SizeType length = static_cast<SizeType>(key.size());
+        EXPECT_TRUE(schema.findProperty(key.c_str(), length) == 0) << key;
+        if (index.find(key.c_str(), length) >= 0)
+            occupied++;
+    }
+    EXPECT_LT(unknown.size() / 2, occupied);
+}
+
+TEST_F(Serializable, FromJson_WideObject) {
+    PerfWide wide;
+    wide.Fill();
+    const std::string expected = wide.toJson();
+
+    // The same members in reverse order, with an unknown key carrying a nested value before each of them.
+    const std::vector<std::string> unknown = MakeUnknownKeys(RegisteredKeys(PerfWide::schema()));
+    Document source;
+    source.Parse(expected.c_str());
+    Document doc;
+    doc.SetObject();
+    size_t next = 0;
+    for (Value::MemberIterator m = source.MemberEnd(); m != source.MemberBegin(); ) {
+        --m;
+        Value skipped(kArrayType);
+        skipped.PushBack(Value(kObjectType).AddMember("city", "Unknown", doc.GetAllocator()), doc.GetAllocator());
+        doc.AddMember(Value(unknown[next++ % unknown.size()].c_str(), doc.GetAllocator()), skipped, doc.GetAllocator());
+        doc.AddMember(Value(m->name, doc.GetAllocator()), Value(m->value, doc.GetAllocator()), doc.GetAllocator());
+    }
+    StringBuffer buffer;
+    Writer<StringBuffer> writer(buffer);
+    doc.Accept(writer);
+    const std::string json = buffer.GetString();
+
+    PerfWide dom, sax;
+    EXPECT_TRUE(dom.fromJson(json));
+    EXPECT_TRUE(sax.fromJsonSax(json));
+    EXPECT_EQ(expected, dom.toJson());
+    EXPECT_EQ(expected, sax.toJson());
+
+    // Dispatching each member through a linear scan of the properties gives the same object.
+    const std::vector<PropertyDescriptor>& properties = PerfWide::schema().getProperties();
+    PerfWide linear;
+    for (Value::ConstMemberIterator m = doc.MemberBegin(); m != doc.MemberEnd(); ++m) {
+        for (const PropertyDescriptor& p : properties) {
+            if (p.keyLength == m->name.GetStringLength() && memcmp(p.key, m->name.GetString(), p.keyLength) == 0) {
+                ClassSchema::deserializeProperty(p, m->value, &linear, false);
+                break;
+            }
+        }
+    }
+    EXPECT_EQ(expected, linear.toJson());
+}
+
+// A subclass that registers members fails loudly on construction instead of dropping those members.
+TEST_F(Serializable, Schema_DerivedClassRegistration) {
+    EXPECT_THROW(PerfAdmin(), std::logic_error);
+
+    PerfGuest guest;
+    guest.name = "guest";
+    guest.visit();
+    PerfPerson person;
+    person.name = "guest";
+    person.visits = 1;
+    EXPECT_EQ(person.toJson(), guest.toJson());
+}
+
+// A person carrying two payload-sized strings, so most of the output is string bytes.
+static PerfPerson MakeLargeStringPerson(size_t length) {
+    PerfPerson person;
+    person.name.assign(length, 'n');
+    person.email.assign(length / 2, 'e');
+    person.email += "\"quoted\"\n";
+    person.email.append(length / 2, 'e');
+    return person;
+}
+
+TEST_F(Serializable, ToJson_String) {
+    PerfRoster roster;
+    EXPECT_TRUE(roster.fromJson(payload_));
+    for (size_t i = 0; i < kTrialCount; i++) {
+        std::string json = roster.toJson();
+        EXPECT_EQ(payload_.size(), json.size());
+    }
+}
+
+TEST_F(Serializable, ToJson_FixedBuffer) {
+    std::vector<PerfPerson> people;
+    EXPECT_TRUE(PerfPerson::fromJsonArray(array_, people));
+    char buffer[4096];
+    for (size_t i = 0; i < kTrialCount; i++) {
+        for (size_t j = 0; j < people.size(); j++)
+            EXPECT_GE(sizeof(buffer), people[j].toJson(buffer, sizeof(buffer)));
+    }
+}
+
+// The thread's default context keeps its buffer between calls, but drops it after an output above the cap or on release().
+TEST_F(Serializable, ToJson_ThreadContextRetention) {
+    std::vector<PerfPerson> people;
+    EXPECT_TRUE(PerfPerson::fromJsonArray(array_, people));
+    ASSERT_FALSE(people.empty());
+    SerializationContext& context = SerializationContext::threadLocal();
+
+    std::string out;
+    people[0].toJson(out);
+    EXPECT_EQ(people[0].toJson(), out);
+    EXPECT_EQ(out.size(), context.getBuffer().GetSize());
+
+    context.release();
+    EXPECT_EQ(0u, context.getBuffer().GetSize());
+
+    std::vector<PerfPerson> many;
+    size_t size = 0;
+    while (size <= SerializationContext::kMaxRetainedSize) {
+        many.push_back(people[many.size() % people.size()]);
+        size += many.back().serializedSize() + 1;
+    }
+    PerfPerson::toJsonArray(many, out);
+    EXPECT_EQ(PerfPerson::serializedArraySize(many), out.size());
+    EXPECT_EQ(0u, context.getBuffer().GetSize());
+}
+
+// Parallel output matches toJsonArray byte for byte, whether it runs as one chunk, several, or more threads than elements.
+TEST_F(Serializable, ToJsonArrayParallel_MatchesSequential) {
+    std::vector<PerfPerson> people;
+    EXPECT_TRUE(PerfPerson::fromJsonArray(array_, people));
+    ASSERT_FALSE(people.empty());
+    while (people.size() < 5 * kParallelChunkItems + 7)
+        people.push_back(people[people.size() % 13]);
+    const std::string expected = PerfPerson::toJsonArray(people);
+
+    const unsigned threadCounts[] = { 0, 1, 2, 3, 5, 8, static_cast<unsigned>(people.size() + 1) };
+    for (size_t i = 0; i < sizeof(threadCounts) / sizeof(threadCounts[0]); i++) {
+        std::string out = "stale";
+        PerfPerson::toJsonArrayParallel(people, out, threadCounts[i]);
+        EXPECT_EQ(expected, out) << threadCounts[i];
+    }
+
+    // Below the chunk threshold, and with nothing to write, the sequential path produces the same bytes.
+    std::vector<PerfPerson> few(people.begin(), people.begin() + 3);
+    EXPECT_EQ(PerfPerson::toJsonArray(few), PerfPerson::toJsonArrayParallel(few, 4));
+    std::vector<PerfPerson> none;
+    EXPECT_EQ("[]", PerfPerson::toJsonArrayParallel(none, 4));
+}
+
+TEST_F(Serializable, SerializedSize_Schema) {
+    PerfRoster roster;
+    EXPECT_TRUE(roster.fromJson(payload_));
+    for (size_t i = 0; i < kTrialCount; i++)
+        EXPECT_EQ(payload_.size(), roster.serializedSize());
+}
+
+TEST_F(Serializable, SerializedSize_MatchesToJson) {
+    std::vector<PerfPerson> people;
+    EXPECT_TRUE(PerfPerson::fromJsonArray(array_, people));
+    EXPECT_EQ(array_.size(), PerfPerson::serializedArraySize(people));
+    for (size_t i = 0; i < people.size(); i++)
+        EXPECT_EQ(people[i].toJson().size(), people[i].serializedSize());
+
+    PerfPerson large = MakeLargeStringPerson(1000);
+    EXPECT_EQ(large.toJson().size(), large.serializedSize());
+}
+
+// The size helpers agree with Writer at their edges: every control character, the ends of the 64-bit range, and unusual doubles.
+TEST_F(Serializable, SerializedSize_Helpers) {
+    for (int c = 0; c < 0x80; c++) {
+        const char str[] = { 'a', static_cast<char>(c), 'b' };
+        StringBuffer buffer;
+        Writer<StringBuffer> writer(buffer);
+        writer.String(str, 3);
+        EXPECT_EQ(buffer.GetSize(), jsonStringSize(str, 3)) << c;
+    }
+
+    uint64_t power = 1;
+    for (size_t digits = 1; digits <= 20; digits++) {
+        EXPECT_EQ(digits, countDecimalDigits(power));
+        if (digits > 1) {
+            EXPECT_EQ(digits - 1, countDecimalDigits(power - 1));
+        }
+        if (digits < 20) power *= 10;
+    }
+    EXPECT_EQ(1u, countDecimalDigits(0));
+    EXPECT_EQ(20u, countDecimalDigits(std::numeric_limits<uint64_t>::max()));
+    EXPECT_EQ(20u, jsonIntSize(std::numeric_limits<int64_t>::min()));
+    EXPECT_EQ(11u, jsonIntSize(std::numeric_limits<int>::min()));
+
+    const double doubles[] = { 0.0, -0.0, 1.0, -1.5, 0.1, 1e21, 1e-7, 123456789012345678.0,
+                               std::numeric_limits<double>::min(), std::numeric_limits<double>::denorm_min(),
+                               -std::numeric_limits<double>::denorm_min(), 2.2250738585072009e-308,
+                               std::numeric_limits<double>::max(), -std::numeric_limits<double>::max(),
+                               std::numeric_limits<double>::epsilon() };
+    for (size_t i = 0; i < sizeof(doubles) / sizeof(doubles[0]); i++) {
+        StringBuffer buffer;
+        Writer<StringBuffer> writer(buffer);
+        writer.Double(doubles[i]);
+        EXPECT_EQ(buffer.GetSize(), jsonDoubleSize(doubles[i])) << doubles[i];
+    }
+}
+
+// Random objects mixing edge values with ordinary ones have serializedSize equal to the length of toJson.
+TEST_F(Serializable, SerializedSize_Randomized) {
+    const int ints[] = { 0, -1, 9, -10, std::numeric_limits<int>::min(), std::numeric_limits<int>::max() };
+    const unsigned int uints[] = { 0, 9, 10, std::numeric_limits<unsigned int>::max() };
+    const uint64_t bigs[] = { 0, 9999, 10000, 10000000000000000000ull, 9999999999999999999ull, std::numeric_limits<uint64_t>::max() };
+    const double doubles[] = { 0.0, -0.0, 0.5, 1e308, -1e-308, std::numeric_limits<double>::denorm_min(),
+                               -std::numeric_limits<double>::denorm_min(), std::numeric_limits<double>::min() };
+    const PerfSizeLevel levels[] = { PerfSizeLevel::Low, PerfSizeLevel::Mid, PerfSizeLevel::High, PerfSizeLevel::Unnamed };
+
+    std::mt19937 rng(20261016);
+    std::uniform_int_distribution<int> coin(0, 1);
+    std::uniform_int_distribution<size_t> textLength(0, 24);
+    std::uniform_int_distribution<int> anyChar(0, 0x7f);
+    std::uniform_int_distribution<size_t> historySize(0, 3);
+    std::uniform_real_distribution<double> anyDouble(-1e6, 1e6);
+    auto pick = [&rng](size_t count) { return std::uniform_int_distribution<size_t>(0, count - 1)(rng); };
+    auto text = [&]() {
+        std::string s(textLength(rng), ' ');
+        for (size_t i = 0; i < s.size(); i++) s[i] = static_cast<char>(anyChar(rng));
+        return s;
+    };
+
+    std::vector<PerfSized> all;
+    for (int trial = 0; trial < 2000; trial++) {
+        PerfSized sized;
+        sized.i = coin(rng) ? ints[pick(sizeof(ints) / sizeof(ints[0]))] : static_cast<int>(rng());
+        sized.u = coin(rng) ? uints[pick(sizeof(uints) / sizeof(uints[0]))] : static_cast<unsigned int>(rng());
+        sized.big = coin(rng) ? bigs[pick(sizeof(bigs) / sizeof(bigs[0]))] : (static_cast<uint64_t>(rng()) << 32 | rng()) >> pick(64);
+        sized.d = coin(rng) ? doubles[pick(sizeof(doubles) / sizeof(doubles[0]))] : anyDouble(rng);
+        sized.flag = coin(rng) != 0;
+        sized.level = levels[pick(sizeof(levels) / sizeof(levels[0]))];
+        sized.text = text();
+        sized.address.street = text();
+        sized.history.resize(historySize(rng));
+        for (size_t i = 0; i < sized.history.size(); i++)
+            sized.history[i].city = text();
+
+        EXPECT_EQ(sized.toJson().size(), sized.serializedSize()) << sized.toJson();
+        all.push_back(sized);
+    }
+    EXPECT_EQ(PerfSized::toJsonArray(all).size(), PerfSized::serializedArraySize(all));
+
+    std::vector<PerfSized> none;
+    EXPECT_EQ(2u, PerfSized::serializedArraySize(none));
+    EXPECT_EQ(PerfSized::toJsonArray(none).size(), PerfSized::serializedArraySize(none));
+}
+
+TEST_F(Serializable, ToJson_ChunkedSink) {
+    PerfRoster roster;
+    EXPECT_TRUE(roster.fromJson(payload_));
+    for (size_t i = 0; i < kTrialCount; i++) {
+        size_t size = 0;
+        auto sink = makeCallbackSink([&size](const char*, size_t length) { size += length; return kSinkOk; });
+        EXPECT_TRUE(roster.toJson(sink));
+        EXPECT_EQ(payload_.size(), size);
+    }
+}
+
+TEST_F(Serializable, ToJson_ChunkedSinkMatchesString) {
+    PerfRoster roster;
+    EXPECT_TRUE(roster.fromJson(payload_));
+    std::string json;
+    size_t largestChunk = 0;
+    auto sink = makeCallbackSink([&](const char* data, size_t length) {
+        json.append(data, length);
+        largestChunk = std::max(largestChunk, length);
+        return kSinkOk;
+    });
+    EXPECT_TRUE(roster.toJson(sink, 1000));
+    EXPECT_EQ(payload_, json);
+    EXPECT_GE(1000u, largestChunk);
+}
+
+// Streams go through the std::ostream overload rather than being mistaken for sinks, whose write must return SinkStatus.
+TEST_F(Serializable, ToJson_OStream) {
+    PerfRoster roster;
+    EXPECT_TRUE(roster.fromJson(payload_));
+    std::ostringstream os;
+    EXPECT_TRUE(roster.toJson(os, 1000));
+    EXPECT_EQ(payload_, os.str());
+
+    // A std::ostream with no buffer fails like std::cout would once it is in an error state.
+    std::ostream broken(nullptr);
+    EXPECT_FALSE(roster.toJson(broken));
+
+    OStreamSink sink(os);
+    EXPECT_TRUE(roster.toJson(sink));
+    EXPECT_EQ(payload_ + payload_, os.str());
+}
+
+// A fresh buffer per trial, so the StringBuffer pays for every realloc while it grows.
+TEST_F(Serializable, ToJsonArray_StringBuffer) {
+    std::vector<PerfPerson> people;
+    EXPECT_TRUE(PerfPerson::fromJsonArray(array_, people));
+    for (size_t i = 0; i < kTrialCount; i++) {
+        StringBuffer buffer;
+        Writer<StringBuffer> writer(buffer);
+        PerfPerson::toJsonArrayWriter(people, writer);
+        EXPECT_EQ(array_.size(), buffer.GetSize());
+    }
+}
+
+TEST_F(Serializable, ToJsonArray_SegmentedBuffer) {
+    std::vector<PerfPerson> people;
+    EXPECT_TRUE(PerfPerson::fromJsonArray(array_, people));
+    for (size_t i = 0; i < kTrialCount; i++) {
+        SegmentedBuffer buffer;
+        PerfPerson::toJsonArray(people, buffer);
+        EXPECT_EQ(array_.size(), buffer.getSize());
+    }
+}
+
+TEST_F(Serializable, ToJsonArray_SegmentedBufferMatchesString) {
+    std::vector<PerfPerson> people;
+    EXPECT_TRUE(PerfPerson::fromJsonArray(array_, people));
+    SegmentedBuffer buffer(1000);
+    PerfPerson::toJsonArray(people, buffer);
+    std::string json;
+    buffer.copyTo(json);
+    EXPECT_EQ(array_, json);
+}
+
+TEST_F(Serializable, ToJson_SegmentedLargeStrings) {
+    PerfPerson person = MakeLargeStringPerson(length_);
+    SegmentedBuffer buffer;
+    for (size_t i = 0; i < kTrialCount; i++) {
+        person.toJson(buffer);
+        EXPECT_LT(2 * length_, buffer.getSize());
+    }
+}
+
+TEST_F(Serializable, ToJson_ScatterLargeStrings) {
+    PerfPerson person = MakeLargeStringPerson(length_);
+    SegmentedBuffer buffer;
+    for (size_t i = 0; i < kTrialCount; i++) {
+        person.toJsonScatter(buffer);
+        EXPECT_LT(2 * length_, buffer.getSize());
+    }
+}
+
+TEST_F(Serializable, ToJson_ScatterMatchesString) {
+    PerfPerson person = MakeLargeStringPerson(length_);
+    SegmentedBuffer buffer(1000);
+    person.toJsonScatter(buffer, 100);
+    std::string json;
+    buffer.copyTo(json);
+    EXPECT_EQ(person.toJson(), json);
+}
+
+// A string of about length bytes mixing plain text, characters that need escaping and multi-byte UTF-8.
+static std::string RandomJsonString(std::mt19937& rng, size_t length) {
+    static const char* const pieces[] = { "a", "b", "z", "0", " ", "\"", "\\", "\n", "\r", "\t", "\b", "\f", "\x01", "\x1f", "/", "\xc3\xa9" };
+    std::uniform_int_distribution<size_t> pick(0, sizeof(pieces) / sizeof(pieces[0]) - 1);
+    std::uniform_int_distribution<int> plain(0, 3);
+    std::string s;
+    while (s.size() < length)
+        s += plain(rng) ? pieces[pick(rng) % 3] : pieces[pick(rng)];
+    return s;
+}
+
+// Random string lengths on both sides of the reference threshold and random block sizes give the same bytes as toJson.
+TEST_F(Serializable, ToJson_ScatterRandomized) {
+    std::mt19937 rng(20261016);
+    std::uniform_int_distribution<size_t> referenceSizes(1, 96);
+    std::uniform_int_distribution<size_t> blockSizes(1, 300);
+    std::uniform_int_distribution<int> offsets(-3, 3);
+    std::uniform_int_distribution<size_t> addressCounts(0, 3);
+
+    for (int trial = 0; trial < 500; trial++) {
+        const size_t referenceSize = referenceSizes(rng);
+        auto around = [&]() { return static_cast<size_t>(std::max<int>(0, static_cast<int>(referenceSize) + offsets(rng))); };
+
+        std::vector<PerfPerson> people(1 + trial % 3);
+        for (size_t i = 0; i < people.size(); i++) {
+            people[i].name = RandomJsonString(rng, around());
+            people[i].email = RandomJsonString(rng, around() * (1 + trial % 4));
+            people[i].age = static_cast<int>(rng() % 100);
+            people[i].homeAddress.street = RandomJsonString(rng, around());
+            people[i].pastAddresses.resize(addressCounts(rng));
+            for (size_t j = 0; j < people[i].pastAddresses.size(); j++)
+                people[i].pastAddresses[j].city = RandomJsonString(rng, around());
+        }
+
+        SegmentedBuffer buffer(blockSizes(rng));
+        std::string json;
+        people[0].toJsonScatter(buffer, referenceSize);
+        buffer.copyTo(json);
+        EXPECT_EQ(people[0].toJson(), json) << "trial " << trial;
+        EXPECT_EQ(json.size(), buffer.getSize());
+
+        PerfPerson::toJsonArrayScatter(people, buffer, referenceSize);
+        buffer.copyTo(json);
+        EXPECT_EQ(PerfPerson::toJsonArray(people), json) << "trial " << trial;
+
+#ifndef _WIN32
+        std::vector<iovec> iovecs;
+        buffer.getIovecs(iovecs);
+        std::string gathered;
+        for (size_t i = 0; i < iovecs.size(); i++)
+            gathered.append(static_cast<const char*>(iovecs[i].iov_base), iovecs[i].iov_len);
+        EXPECT_EQ(json, gathered) << "trial " << trial;
+#endif
+    }
+}
+
+TEST_F(Serializable, FromJsonArray_Document) {
+    for (size_t i = 0; i < kTrialCount; i++) {
+        std::vector<PerfPerson> people;
+        EXPECT_TRUE(PerfPerson::fromJsonArray(array_, people));
+    }
+}
+
+TEST_F(Serializable, FromJsonArrayStream_Reader) {
+    for (size_t i = 0; i < kTrialCount; i++) {
+        size_t count = 0;
+        StringStream stream(array_.c_str());
+        EXPECT_TRUE(PerfPerson::fromJsonArrayStream(stream, [&count](PerfPerson&) { count++; }));
+        EXPECT_LT(0u, count);
+    }
+}
+
+TEST_F(Serializable, FromJsonArrayStream_MatchesDocument) {
+    std::vector<PerfPerson> people, streamed;
+    EXPECT_TRUE(PerfPerson::fromJsonArray(array_, people));
+    StringStream stream(array_.c_str());
+    EXPECT_TRUE(PerfPerson::fromJsonArrayStream(stream, [&streamed](PerfPerson& person) { streamed.push_back(person); }));
+    EXPECT_EQ(array_, PerfPerson::toJsonArray(people));
+    EXPECT_EQ(array_, PerfPerson::toJsonArray(streamed));
+}
+
+TEST_F(Serializable, JsonPushParser_Packets) {
+    for (size_t i = 0; i < kTrialCount; i++)
+        EXPECT_LT(0u, PushLines(1460));
+}
+
+TEST_F(Serializable, JsonPushParser_MatchesReader) {
+    PerfRoster roster;
+    EXPECT_TRUE(roster.fromJson(payload_));
+
+    const size_t packetSizes[] = { 1, 7, 1460, lines_.size() };
+    for (size_t i = 0; i < sizeof(packetSizes) / sizeof(packetSizes[0]); i++) {
+        std::vector<PerfPerson> people;
+        EXPECT_EQ(roster.people.size(), PushLines(packetSizes[i], &people));
+        EXPECT_EQ(PerfPerson::toJsonArray(roster.people), PerfPerson::toJsonArray(people));
+    }
+}
+
+// JsonLinesIngest timed at several thread counts; compare them on a multi-core machine.
+
+TEST_F(Serializable, JsonLinesIngest_1Thread) {
+    for (size_t i = 0; i < kTrialCount; i++)
+        EXPECT_LT(0u, IngestLines(1));
+}
+
+TEST_F(Serializable, JsonLinesIngest_2Threads) {
+    for (size_t i = 0; i < kTrialCount; i++)
+        EXPECT_LT(0u, IngestLines(2));
+}
+
+TEST_F(Serializable, JsonLinesIngest_4Threads) {
+    for (size_t i = 0; i < kTrialCount; i++)
+        EXPECT_LT(0u, IngestLines(4));
+}
+
+TEST_F(Serializable, JsonLinesIngest_HardwareThreads) {
+    for (size_t i = 0; i < kTrialCount; i++)
+        EXPECT_LT(0u, IngestLines(0));
+}
+
+TEST_F(Serializable, JsonLinesIngest_MatchesReader) {
+    PerfRoster roster;
+    EXPECT_TRUE(roster.fromJson(payload_));
+
+    std::vector<PerfPerson> people;
+    JsonLinesIngest<PerfPerson>::Options options;
+    options.chunkSize = lines_.size() / 16 + 1;
+    JsonLinesIngest<PerfPerson>::Result result = JsonLinesIngest<PerfPerson>::ingest(lines_.data(), lines_.size(),
+        [&people](JsonLinesIngest<PerfPerson>::Batch& batch) {
+            people.insert(people.end(), batch.records.begin(), batch.records.end());
+        }, options);
+    EXPECT_EQ(0u, result.badLines);
+    EXPECT_EQ(roster.people.size(), result.records);
+    ASSERT_EQ(roster.people.size(), people.size());
+    for (size_t i = 0; i < people.size(); i++)
+        EXPECT_EQ(roster.people[i].toJson(), people[i].toJson());
+}
+
+// Writes contents to an anonymous temporary file and rewinds it for reading.
+static std::FILE* TempFileWith(const std::string& contents) {
+    std::FILE* fp = std::tmpfile();
+    if (fp) {
+        fwrite(contents.data(), 1, contents.size(), fp);
+        rewind(fp);
+    }
+    return fp;
+}
+
+// Reads every line of fp, appending decoded records to people and the offsets of bad lines to badLineOffsets.
+static void ReadAllLines(std::FILE* fp, size_t bufferSize, std::vector<PerfPerson>& people, std::vector<size_t>& badLineOffsets) {
+    JsonLinesReader<PerfPerson> reader(fp, bufferSize);
+    reader.forEach([&people](PerfPerson& person) { people.push_back(person); },
+                   [&badLineOffsets](JsonLinesReader<PerfPerson>& r) { badLineOffsets.push_back(r.getLineOffset()); });
+}
+
+TEST_F(Serializable, JsonLinesWriter_MatchesToJson) {
+    PerfRoster roster;
+    EXPECT_TRUE(roster.fromJson(payload_));
+
+    std::FILE* fp = std::tmpfile();
+    ASSERT_TRUE(fp != nullptr);
+    {
+        // A buffer smaller than one record makes every line cross a flush.
+        JsonLinesWriter<PerfPerson> writer(fp, 16);
+        for (size_t i = 0; i < roster.people.size(); i++)
+            writer.write(roster.people[i]);
+    }
+    rewind(fp);
+    std::string written(lines_.size() + 1, '\0');
+    written.resize(fread(&written[0], 1, written.size(), fp));
+    fclose(fp);
+    EXPECT_EQ(lines_, written);
+}
+
+// Lines longer than the read buffer are joined before decoding, and the final line needs no newline.
+TEST_F(Serializable, JsonLinesReader_LinesSpanBuffer) {
+    PerfRoster roster;
+    EXPECT_TRUE(roster.fromJson(payload_));
+    const std::string expected = PerfPerson::toJsonArray(roster.people);
+
+    const std::string trimmed = lines_.substr(0, lines_.size() - 1);
+    const std::string inputs[] = { lines_, trimmed };
+    const size_t bufferSizes[] = { 1, 7, 64, JsonLinesReader<PerfPerson>::kDefaultBufferSize };
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        for (size_t j = 0; j < sizeof(bufferSizes) / sizeof(bufferSizes[0]); j++) {
+            std::FILE* fp = TempFileWith(inputs[i]);
+            ASSERT_TRUE(fp != nullptr);
+            std::vector<PerfPerson> people;
+            std::vector<size_t> badLineOffsets;
+            ReadAllLines(fp, bufferSizes[j], people, badLineOffsets);
+            fclose(fp);
+            EXPECT_TRUE(badLineOffsets.empty());
+            EXPECT_EQ(expected, PerfPerson::toJsonArray(people)) << i << ", " << bufferSizes[j];
+        }
+    }
+}
+
+// A bad line is reported at its own line number and byte offset, and the lines after it still decode.
+TEST_F(Serializable, JsonLinesReader_BadLine) {
+    const std::string first = "{\"name\":\"Ann\",\"age\":30}\n";
+    const std::string broken = "{\"name\":\"Bob\",\"age\":}\n";
+    const std::string blank = " \t\n";
+    const std::string notObject = "[1,2]\n";
+    const std::string last = "{\"name\":\"Cy\",\"age\":40}";
+    const std::string contents = first + broken + blank + notObject + last;
+    const size_t brokenOffset = first.size();
+    const size_t notObjectOffset = first.size() + broken.size() + blank.size();
+
+    const size_t bufferSizes[] = { 5, JsonLinesReader<PerfPerson>::kDefaultBufferSize };
+    for (size_t i = 0; i < sizeof(bufferSizes) / sizeof(bufferSizes[0]); i++) {
+        std::FILE* fp = TempFileWith(contents);
+        ASSERT_TRUE(fp != nullptr);
+        JsonLinesReader<PerfPerson> reader(fp, bufferSizes[i]);
+
+        EXPECT_EQ(JsonLinesReader<PerfPerson>::kRecord, reader.read());
+        EXPECT_EQ("Ann", reader.getRecord().name);
+
+        EXPECT_EQ(JsonLinesReader<PerfPerson>::kBadLine, reader.read());
+        EXPECT_EQ(2u, reader.getLineNumber());
+        EXPECT_EQ(brokenOffset, reader.getLineOffset());
+        EXPECT_EQ(kParseErrorValueInvalid, reader.getParseError());
+        EXPECT_EQ(broken.find('}'), reader.getErrorOffset());
+
+        EXPECT_EQ(JsonLinesReader<PerfPerson>::kBadLine, reader.read());
+        EXPECT_EQ(4u, reader.getLineNumber());
+        EXPECT_EQ(notObjectOffset, reader.getLineOffset());
+        EXPECT_EQ(kParseErrorNone, reader.getParseError());
+
+        EXPECT_EQ(JsonLinesReader<PerfPerson>::kRecord, reader.read());
+        EXPECT_EQ(5u, reader.getLineNumber());
+        EXPECT_EQ("Cy", reader.getRecord().name);
+        EXPECT_EQ(40, reader.getRecord().age);
+
+        EXPECT_EQ(JsonLinesReader<PerfPerson>::kEnd, reader.read());
+        fclose(fp);
+    }
+
+    // JsonLinesIngest reports the same offsets, whether the bad lines share a chunk or not.
+    const size_t chunkSizes[] = { 1, contents.size() };
+    for (size_t i = 0; i < sizeof(chunkSizes) / sizeof(chunkSizes[0]); i++) {
+        JsonLinesIngest<PerfPerson>::Options options;
+        options.threadCount = 2;
+        options.chunkSize = chunkSizes[i];
+        std::vector<size_t> badLineOffsets;
+        std::vector<std::string> names;
+        JsonLinesIngest<PerfPerson>::Result result = JsonLinesIngest<PerfPerson>::ingest(contents.data(), contents.size(),
+            [&](JsonLinesIngest<PerfPerson>::Batch& batch) {
+                badLineOffsets.insert(badLineOffsets.end(), batch.badLineOffsets.begin(), batch.badLineOffsets.end());
+                for (size_t j = 0; j < batch.records.size(); j++)
+                    names.push_back(batch.records[j].name);
+            }, options);
+        EXPECT_EQ(2u, result.records);
+        EXPECT_EQ(2u, result.badLines);
+        ASSERT_EQ(2u, badLineOffsets.size());
+        EXPECT_EQ(brokenOffset, badLineOffsets[0]);
+        EXPECT_EQ(notObjectOffset, badLineOffsets[1]);
+        ASSERT_EQ(2u, names.size());
+        EXPECT_EQ("Ann", names[0]);
+        EXPECT_EQ("Cy", names[1]);
+    }
+}
+
+// \r\n line endings decode like \n, and offsets count the \r.
+TEST_F(Serializable, JsonLinesReader_CrLf) {
+    PerfRoster roster;
+    EXPECT_TRUE(roster.fromJson(payload_));
+    const std::string expected = PerfPerson::toJsonArray(roster.people);
+
+    std::string contents;
+    for (size_t i = 0; i < roster.people.size(); i++) {
+        contents += roster.people[i].toJson();
+        contents += "\r\n";
+    }
+    contents += "[]\r\n";
+    const size_t badLineOffset = contents.size() - 4;
+    contents += "\r\n";
+
+    std::FILE* fp = TempFileWith(contents);
+    ASSERT_TRUE(fp != nullptr);
+    std::vector<PerfPerson> people;
+    std::vector<size_t> badLineOffsets;
+    ReadAllLines(fp, 64, people, badLineOffsets);
+    fclose(fp);
+    EXPECT_EQ(expected, PerfPerson::toJsonArray(people));
+    ASSERT_EQ(1u, badLineOffsets.size());
+    EXPECT_EQ(badLineOffset, badLineOffsets[0]);
+
+    std::vector<PerfPerson> ingested;
+    JsonLinesIngest<PerfPerson>::Options options;
+    options.chunkSize = contents.size() / 8 + 1;
+    JsonLinesIngest<PerfPerson>::Result result = JsonLinesIngest<PerfPerson>::ingest(contents.data(), contents.size(),
+        [&ingested](JsonLinesIngest<PerfPerson>::Batch& batch) {
+            ingested.insert(ingested.end(), batch.records.begin(), batch.records.end());
+        }, options);
+    EXPECT_EQ(1u, result.badLines);
+    EXPECT_EQ(expected, PerfPerson::toJsonArray(ingested));
+}
+
+// ingestFile reads the file in windows yet delivers the records, in order, exactly as a single JsonLinesReader reads them.
+TEST_F(Serializable, JsonLinesIngest_FileMatchesReader) {
+    // A bad line every 37 records, and no newline after the last line.
+    std::string contents;
+    size_t lineCount = 0;
+    for (size_t offset = 0; offset < lines_.size(); lineCount++) {
+        if (lineCount % 37 == 36) contents += "{\"name\":\n";
+        const size_t newline = lines_.find('\n', offset);
+        contents.append(lines_, offset, newline - offset + 1);
+        offset = newline + 1;
+    }
+    contents.resize(contents.size() - 1);
+
+    std::FILE* fp = TempFileWith(contents);
+    ASSERT_TRUE(fp != nullptr);
+    std::vector<PerfPerson> expected;
+    std::vector<size_t> expectedBadLines;
+    ReadAllLines(fp, JsonLinesReader<PerfPerson>::kDefaultBufferSize, expected, expectedBadLines);
+    EXPECT_LT(0u, expectedBadLines.size());
+
+    const unsigned threadCounts[] = { 1, 4 };
+    for (size_t i = 0; i < sizeof(threadCounts) / sizeof(threadCounts[0]); i++) {
+        rewind(fp);
+        JsonLinesIngest<PerfPerson>::Options options;
+        options.threadCount = threadCounts[i];
+        options.chunkSize = 700;
+        std::vector<PerfPerson> people;
+        std::vector<size_t> badLineOffsets;
+        size_t nextChunk = 0;
+        JsonLinesIngest<PerfPerson>::Result result = JsonLinesIngest<PerfPerson>::ingestFile(fp,
+            [&](JsonLinesIngest<PerfPerson>::Batch& batch) {
+                EXPECT_EQ(nextChunk++, batch.chunkIndex);
+                people.insert(people.end(), batch.records.begin(), batch.records.end());
+                badLineOffsets.insert(badLineOffsets.end(), batch.badLineOffsets.begin(), batch.badLineOffsets.end());
+            }, options);
+        EXPECT_EQ(result.chunks, nextChunk);
+        EXPECT_LT(1u, result.chunks);
+        EXPECT_EQ(expected.size(), result.records);
+        EXPECT_EQ(PerfPerson::toJsonArray(expected), PerfPerson::toJsonArray(people));
+        EXPECT_EQ(expectedBadLines, badLineOffsets);
+    }
+    fclose(fp);
+}
+
+// A consumer failure stops the delivery of further batches and reaches the caller after every thread has finished.
+TEST_F(Serializable, JsonLinesIngest_ConsumerFailure) {
+    std::FILE* fp = TempFileWith(lines_);
+    ASSERT_TRUE(fp != nullptr);
+    const unsigned threadCounts[] = { 1, 4 };
+    for (size_t i = 0; i < sizeof(threadCounts) / sizeof(threadCounts[0]); i++) {
+        JsonLinesIngest<PerfPerson>::Options options;
+        options.threadCount = threadCounts[i];
+        options.chunkSize = 700;
+        size_t delivered = 0;
+        auto consumer = [&delivered](JsonLinesIngest<PerfPerson>::Batch&) {
+            if (++delivered == 3) throw std::runtime_error("consumer");
+        };
+
+        EXPECT_THROW(JsonLinesIngest<PerfPerson>::ingest(lines_.data(), lines_.size(), consumer, options), std::runtime_error);
+        EXPECT_EQ(3u, delivered);
+
+        delivered = 0;
+        rewind(fp);
+        EXPECT_THROW(JsonLinesIngest<PerfPerson>::ingestFile(fp, consumer, options), std::runtime_error);
+        EXPECT_EQ(3u, delivered);
+    }
+    fclose(fp);
+}
+
+// A line longer than the read window makes the window grow, and the lines after it still arrive in order.
+TEST_F(Serializable, JsonLinesIngest_FileLongLine) {
+    PerfPerson person = MakeLargeStringPerson(20000);
+    std::string contents = lines_.substr(0, lines_.find('\n') + 1) + person.toJson() + "\n" + lines_;
+    std::FILE* fp = TempFileWith(contents);
+    ASSERT_TRUE(fp != nullptr);
+
+    std::vector<PerfPerson> expected;
+    std::vector<size_t> expectedBadLines;
+    ReadAllLines(fp, JsonLinesReader<PerfPerson>::kDefaultBufferSize, expected, expectedBadLines);
+    rewind(fp);
+
+    JsonLinesIngest<PerfPerson>::Options options;
+    options.threadCount = 2;
+    options.chunkSize = 700;
+    std::vector<PerfPerson> people;
+    JsonLinesIngest<PerfPerson>::ingestFile(fp, [&people](JsonLinesIngest<PerfPerson>::Batch& batch) {
+        people.insert(people.end(), batch.records.begin(), batch.records.end());
+    }, options);
+    EXPECT_EQ(PerfPerson::toJsonArray(expected), PerfPerson::toJsonArray(people));
+    EXPECT_EQ(person.toJson(), people[1].toJson());
+    fclose(fp);
+}
+
+TEST_F(Serializable, EnumSerializer_ConcurrentRegistration) {
+    TestConcurrentEnumRegistration<EnumSerializer, PerfShade>();
+}
+
+#ifndef _WIN32
+// Mapped files decode whether or not their size is a multiple of the page size; empty and missing files fail.
+TEST_F(Serializable, FromJsonFile_Boundaries) {
+    std::vector<PerfPerson> expected;
+    EXPECT_TRUE(PerfPerson::fromJsonArray(array_, expected));
+    ASSERT_FALSE(expected.empty());
+    const std::string single = expected[0].toJson();
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+    std::vector<PerfPerson> people;
+    PerfPerson person;
+    std::string path = TempPathWith("");
+    ASSERT_FALSE(path.empty());
+    EXPECT_FALSE(PerfPerson::fromJsonArrayFile(path, people));
+    EXPECT_FALSE(person.fromJsonFile(path));
+    remove(path.c_str());
+    EXPECT_FALSE(PerfPerson::fromJsonArrayFile(path, people));
+    EXPECT_FALSE(person.fromJsonFile(path));
+
+    // A document cut off at a page boundary fails without reading past the mapping.
+    path = TempPathWith(array_.substr(0, page));
+    ASSERT_FALSE(path.empty());
+    EXPECT_FALSE(PerfPerson::fromJsonArrayFile(path, people));
+    remove(path.c_str());
+
+    // Trailing spaces pad the array to one byte short of, exactly, and one byte past a page boundary.
+    const size_t aligned = (array_.size() / page + 1) * page;
+    const size_t sizes[] = { array_.size(), aligned - 1, aligned, aligned + 1 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        path = TempPathWith(array_ + std::string(sizes[i] - array_.size(), ' '));
+        ASSERT_FALSE(path.empty());
+        people.clear();
+        EXPECT_TRUE(PerfPerson::fromJsonArrayFile(path, people)) << sizes[i];
+        EXPECT_EQ(array_, PerfPerson::toJsonArray(people));
+        remove(path.c_str());
+    }
+
+    path = TempPathWith(single);
+    ASSERT_FALSE(path.empty());
+    EXPECT_TRUE(person.fromJsonFile(path));
+    EXPECT_EQ(single, person.toJson());
+    remove(path.c_str());
+}
+#endif
+
+TEST_F(Serializable, JsonPushParser_Framing) {
+    TestPushParserFraming<JsonPushParser<PerfPerson>, PerfPerson>();
+}
+
+#endif // TEST_SERIALIZABLE
@@ -0,0 +1,132 @@
+//
+//  serializabletest.h
+//  JsonParser
+//
+//  Created by 朱继超 on 10/16/26.
+//
+
+#ifndef SERIALIZABLETEST_H_
+#define SERIALIZABLETEST_H_
+
+#include "perftest.h"
+
+// Types and the fixture shared by serializabletest.cpp and allocationtest.cpp.
+
+#if TEST_SERIALIZABLE
+
+#include "rapid_json_wrapper.hpp"
+#include "rapid_json_lines.hpp"
+#include "rapid_json_push_parser.hpp"
+
+class PerfAddress : public rapidjson::JSONSerializable<PerfAddress> {
+public:
+    std::string street;
+    std::string city;
+    std::string zipCode;
+
+    PerfAddress() {
+        registerProperty("street", street);
+        registerProperty("city", city);
+        registerProperty("zipCode", zipCode);
+    }
+};
+
+class PerfPerson : public rapidjson::JSONSerializable<PerfPerson> {
+public:
+    std::string name;
+    std::string email;
+    int age;
+    unsigned int visits;
+    double score;
+    bool active;
+    PerfAddress homeAddress;
+    std::vector<PerfAddress> pastAddresses;
+
+    PerfPerson() : age(0), visits(0), score(0), active(false) {
+        registerProperty("name", name);
+        registerProperty("email", email);
+        registerProperty("age", age);
+        registerProperty("visits", visits);
+        registerProperty("score", score);
+        registerProperty("active", active);
+        registerNestedObject("homeAddress", homeAddress);
+        registerNestedArray("pastAddresses", pastAddresses);
+    }
+};
+
+class PerfRoster : public rapidjson::JSONSerializable<PerfRoster> {
+public:
+    std::vector<PerfPerson> people;
+
+    PerfRoster() {
+        registerNestedArray("people", people);
+    }
+};
+
+class Serializable : public PerfTest {
+public:
+    Serializable() : payload_(), array_(), lines_() {}
+
+    virtual void SetUp() {
+        PerfTest::SetUp();
+
+        // Grow a roster until its JSON is at least as long as sample.json.
+        PerfRoster roster;
+        for (int i = 0; payload_.size() < length_; i++) {
+            PerfPerson person;
+            person.name = "Person \"" + std::to_string(i) + "\"";
+            person.email = "person" + std::to_string(i) + "@example.com";
+            person.age = 20 + i % 50;
+            person.visits = static_cast<unsigned int>(i) * 7u;
+            person.score = i * 0.25;
+            person.active = (i % 3) != 0;
+            person.homeAddress.street = std::to_string(i) + " Home Street";
+            person.homeAddress.city = "Hometown";
+            person.homeAddress.zipCode = std::to_string(10000 + i);
+            person.pastAddresses.resize(static_cast<size_t>(i % 4));
+            for (size_t j = 0; j < person.pastAddresses.size(); j++) {
+                person.pastAddresses[j].street = std::to_string(j) + " Old Lane";
+                person.pastAddresses[j].city = "OldCity\t" + std::to_string(j);
+                person.pastAddresses[j].zipCode = "1111" + std::to_string(j);
+            }
+            roster.people.push_back(person);
+            lines_ += person.toJson();
+            lines_ += '\n';
+            if (i % 64 == 0)
+                payload_ = roster.toJson();
+        }
+        array_ = PerfPerson::toJsonArray(roster.people);
+    }
+
+protected:
+    // Ingests lines_ on threadCount threads in chunks small enough to keep every thread busy.
+    size_t IngestLines(unsigned threadCount) const {
+        rapidjson::JsonLinesIngest<PerfPerson>::Options options;
+        options.threadCount = threadCount;
+        options.chunkSize = lines_.size() / 64 + 1;
+        size_t records = 0;
+        rapidjson::JsonLinesIngest<PerfPerson>::ingest(lines_.data(), lines_.size(),
+            [&records](rapidjson::JsonLinesIngest<PerfPerson>::Batch& batch) { records += batch.records.size(); }, options);
+        return records;
+    }
+
+    // Pushes lines_ through a JsonPushParser in packets of packetSize bytes.
+    size_t PushLines(size_t packetSize, std::vector<PerfPerson>* people = 0) const {
+        rapidjson::JsonPushParser<PerfPerson> parser;
+        size_t records = 0;
+        for (size_t offset = 0; offset < lines_.size(); offset += packetSize) {
+            records += parser.feed(lines_.data() + offset, std::min(packetSize, lines_.size() - offset),
+                [people](PerfPerson& person) { if (people) people->push_back(person); },
+                [](const rapidjson::JsonPushParser<PerfPerson>&) {});
+        }
+        return records;
+    }
+
+    std::string payload_;
+    std::string array_;     // The people of payload_ as a top-level array.
+    std::string lines_;     // The people of payload_ as JSON Lines.
+};
+
+#endif // TEST_SERIALIZABLE
+
+#endif // SERIALIZABLETEST_H_
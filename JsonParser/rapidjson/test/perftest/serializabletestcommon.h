@@ -0,0 +1,138 @@
+//
+//  serializabletestcommon.h
+//  JsonParser
+//
+//  Created by 朱继超 on 10/16/26.
+//
+
+#ifndef SERIALIZABLETESTCOMMON_H_
+#define SERIALIZABLETESTCOMMON_H_
+
+#include "perftest.h"
+
+// Helpers and inputs shared by serializabletest.cpp and nlohmannserializabletest.cpp; each backend file keeps only what differs.
+
+#if TEST_SERIALIZABLE
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#ifndef _WIN32
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#endif
+
+// Keys that are not among the registered ones but look like them: extended, truncated or with one byte changed.
+inline std::vector<std::string> MakeUnknownKeys(const std::vector<std::string>& registered) {
+    std::vector<std::string> keys(1, std::string());
+    for (const std::string& key : registered) {
+        keys.push_back(key + "x");
+        keys.push_back("x" + key);
+        keys.push_back(key.substr(0, key.size() - 1));
+        std::string changed = key;
+        changed[changed.size() - 1] ^= 1;
+        keys.push_back(changed);
+    }
+    std::vector<std::string> unknown;
+    for (const std::string& key : keys) {
+        if (std::find(registered.begin(), registered.end(), key) == registered.end())
+            unknown.push_back(key);
+    }
+    return unknown;
+}
+
+// Threads registering the same names while others look them up all see a complete registry,
+// and a name returned before a later registration stays valid. Shade has Light, Medium, Dark and Black, registered nowhere else.
+template<template<typename> class Serializer, typename Shade>
+void TestConcurrentEnumRegistration() {
+    Serializer<Shade>& shades = Serializer<Shade>::instance();
+    const char* const names[] = { "light", "medium", "dark" };
+    std::atomic<size_t> mismatches(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < 3000; i++) {
+                const Shade value = static_cast<Shade>(i % 3);
+                shades.registerValue(names[i % 3], value);
+                const std::string* name = Serializer<Shade>::nameOf(value);
+                Shade decoded = Shade::Light;
+                if (!name || *name != names[i % 3] || !Serializer<Shade>::valueOf(names[i % 3], decoded) || decoded != value)
+                    mismatches++;
+            }
+        });
+    }
+    for (size_t t = 0; t < threads.size(); t++)
+        threads[t].join();
+    EXPECT_EQ(0u, mismatches.load());
+
+    const std::string* dark = Serializer<Shade>::nameOf(Shade::Dark);
+    ASSERT_TRUE(dark != nullptr);
+    shades.registerValue("black", Shade::Black);
+    EXPECT_EQ("dark", *dark);
+    ASSERT_TRUE(Serializer<Shade>::nameOf(Shade::Black) != nullptr);
+    EXPECT_EQ("black", *Serializer<Shade>::nameOf(Shade::Black));
+}
+
+#ifndef _WIN32
+// Writes contents to a new temporary file and returns its path, or an empty string on failure; the caller removes it.
+inline std::string TempPathWith(const std::string& contents) {
+    char path[] = "/tmp/serializabletestXXXXXX";
+    const int fd = mkstemp(path);
+    if (fd < 0) return std::string();
+    const bool written = write(fd, contents.data(), contents.size()) == static_cast<ssize_t>(contents.size());
+    close(fd);
+    if (!written) {
+        remove(path);
+        return std::string();
+    }
+    return path;
+}
+#endif
+
+// Documents split at every byte, strings holding quotes and brackets, back-to-back documents and a truncated tail all frame correctly.
+// Record has a string member name; Parser is the backend's JsonPushParser<Record>.
+template<typename Parser, typename Record>
+void TestPushParserFraming() {
+    const std::string first = "{\"name\":\"a\\\"}{[\",\"age\":1}";
+    const std::string notObject = "[1]";
+    const std::string second = "{\"name\":\"b\"}";
+    const std::string truncated = "{\"name\":\"c\",\"age\":";
+    const std::string contents = first + " \n" + notObject + second + truncated;
+    const size_t notObjectOffset = first.size() + 2;
+    const size_t truncatedOffset = notObjectOffset + notObject.size() + second.size();
+
+    const size_t packetSizes[] = { 1, 3, contents.size() };
+    for (size_t i = 0; i < sizeof(packetSizes) / sizeof(packetSizes[0]); i++) {
+        Parser parser;
+        std::vector<std::string> names;
+        std::vector<size_t> badOffsets;
+        auto onDocument = [&names](Record& person) { names.push_back(person.name); };
+        auto onBadDocument = [&badOffsets](const Parser& p) { badOffsets.push_back(p.getDocumentOffset()); };
+
+        size_t count = 0;
+        for (size_t offset = 0; offset < contents.size(); offset += packetSizes[i])
+            count += parser.feed(contents.data() + offset, std::min(packetSizes[i], contents.size() - offset), onDocument, onBadDocument);
+        EXPECT_EQ(2u, count);
+        EXPECT_EQ(truncated.size(), parser.getPendingSize());
+        EXPECT_EQ(0u, parser.finish(onDocument, onBadDocument));
+        EXPECT_EQ(0u, parser.getPendingSize());
+
+        ASSERT_EQ(2u, names.size());
+        EXPECT_EQ("a\"}{[", names[0]);
+        EXPECT_EQ("b", names[1]);
+        ASSERT_EQ(2u, badOffsets.size());
+        EXPECT_EQ(notObjectOffset, badOffsets[0]);
+        EXPECT_EQ(truncatedOffset, badOffsets[1]);
+
+        // After finish the parser starts over, and offsets keep counting the bytes already fed.
+        EXPECT_EQ(1u, parser.feed(second.data(), second.size(), onDocument, onBadDocument));
+        EXPECT_EQ(contents.size(), parser.getDocumentOffset());
+    }
+}
+
+#endif // TEST_SERIALIZABLE
+
+#endif // SERIALIZABLETESTCOMMON_H_